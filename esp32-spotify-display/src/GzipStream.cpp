@@ -0,0 +1,138 @@
+#include "GzipStream.h"
+
+#define GZIP_FHCRC    0x02
+#define GZIP_FEXTRA   0x04
+#define GZIP_FNAME    0x08
+#define GZIP_FCOMMENT 0x10
+
+GzipStream::GzipStream(GzipSource source) {
+  this->source = source;
+  inflator     = nullptr;
+  window       = nullptr;
+  // The body is already in memory, a read that comes up short won't be
+  // filled by waiting
+  setTimeout(0);
+
+  // Check the header before committing to the window
+  if (!skipHeader()) {
+    failed = true;
+    return;
+  }
+
+  inflator = new (std::nothrow) tinfl_decompressor;
+  window   = new (std::nothrow) uint8_t[TINFL_LZ_DICT_SIZE];
+  if (!inflator || !window) {
+    failed = true;
+    return;
+  }
+
+  tinfl_init(inflator);
+}
+
+GzipStream::~GzipStream() {
+  delete inflator;
+  delete[] window;
+}
+
+bool GzipStream::ok() {
+  return !failed;
+}
+
+// Next byte of the compressed body, -1 once it runs out
+int GzipStream::rawByte() {
+  if (inPos == inLen) {
+    inLen = moreInput ? source(in, sizeof(in)) : 0;
+    inPos = 0;
+    if (inLen == 0) {
+      moreInput = false;
+      return -1;
+    }
+  }
+
+  return in[inPos++];
+}
+
+bool GzipStream::skipHeader() {
+  uint8_t header[10];
+  for (int i = 0; i < 10; i++) {
+    int c = rawByte();
+    if (c < 0) return false;
+    header[i] = c;
+  }
+
+  // Magic and deflate method
+  if (header[0] != 0x1f || header[1] != 0x8b || header[2] != 8) return false;
+
+  uint8_t flags = header[3];
+  if (flags & GZIP_FEXTRA) {
+    int lo = rawByte();
+    int hi = rawByte();
+    if (hi < 0) return false;
+    for (int len = lo | (hi << 8); len > 0; len--) {
+      if (rawByte() < 0) return false;
+    }
+  }
+
+  // Zero terminated file name and comment
+  if (flags & GZIP_FNAME) {
+    for (int c = rawByte(); c != 0; c = rawByte()) if (c < 0) return false;
+  }
+  if (flags & GZIP_FCOMMENT) {
+    for (int c = rawByte(); c != 0; c = rawByte()) if (c < 0) return false;
+  }
+
+  if (flags & GZIP_FHCRC) {
+    rawByte();
+    if (rawByte() < 0) return false;
+  }
+
+  return true;
+}
+
+// Inflates until there is output to hand out, false at the end of the body
+bool GzipStream::fill() {
+  while (outLen == 0) {
+    if (failed || status == TINFL_STATUS_DONE) return false;
+
+    if (inPos == inLen && moreInput) {
+      inLen = source(in, sizeof(in));
+      inPos = 0;
+      moreInput = inLen != 0;
+    }
+
+    size_t inAvail  = inLen - inPos;
+    size_t outAvail = TINFL_LZ_DICT_SIZE - windowPos;
+    status = tinfl_decompress(inflator, in + inPos, &inAvail, window, window + windowPos, &outAvail,
+                              moreInput ? TINFL_FLAG_HAS_MORE_INPUT : 0);
+
+    inPos    += inAvail;
+    outPos    = windowPos;
+    outLen    = outAvail;
+    windowPos = (windowPos + outAvail) & (TINFL_LZ_DICT_SIZE - 1);
+
+    if (status < TINFL_STATUS_DONE) failed = true;
+    // Out of input with nothing produced, the body was cut short
+    if (outLen == 0 && status == TINFL_STATUS_NEEDS_MORE_INPUT && !moreInput) failed = true;
+  }
+
+  return true;
+}
+
+int GzipStream::available() {
+  return fill() ? outLen : 0;
+}
+
+int GzipStream::read() {
+  if (!fill()) return -1;
+  outLen--;
+  return window[outPos++];
+}
+
+int GzipStream::peek() {
+  if (!fill()) return -1;
+  return window[outPos];
+}
+
+size_t GzipStream::write(uint8_t b) {
+  return 0;
+}
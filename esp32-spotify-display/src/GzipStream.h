@@ -0,0 +1,49 @@
+#ifndef GZIPSTREAM_H
+#define GZIPSTREAM_H
+#include <Arduino.h>
+#include <functional>
+
+#if __has_include("esp32/rom/miniz.h")
+  #include "esp32/rom/miniz.h"
+#else
+  #include "rom/miniz.h"
+#endif
+
+#define GZIP_IN_BUF_SIZE 512
+
+// Reads up to len raw body bytes into buf, returning 0 at the end of the body
+typedef std::function<size_t(uint8_t* buf, size_t len)> GzipSource;
+
+// Inflates a gzip response body on the fly, so it can be handed straight to
+// deserializeJson. Uses the inflater in the ESP32 ROM, with the deflate
+// window as a circular output buffer; nothing is kept besides the window.
+class GzipStream : public Stream {
+  private:
+    GzipSource source;
+    tinfl_decompressor* inflator;
+    uint8_t* window;
+    uint8_t in[GZIP_IN_BUF_SIZE];
+    size_t inPos = 0;
+    size_t inLen = 0;
+    bool moreInput = true;
+    size_t outPos = 0;
+    size_t outLen = 0;
+    size_t windowPos = 0;
+    tinfl_status status = TINFL_STATUS_NEEDS_MORE_INPUT;
+    bool failed = false;
+
+    int rawByte();
+    bool skipHeader();
+    bool fill();
+
+  public:
+    GzipStream(GzipSource source);
+    ~GzipStream();
+    bool ok();
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t write(uint8_t b) override;
+};
+
+#endif
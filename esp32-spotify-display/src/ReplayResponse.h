@@ -0,0 +1,48 @@
+#ifndef REPLAYRESPONSE_H
+#define REPLAYRESPONSE_H
+#include <Arduino.h>
+#include <memory>
+
+// A finished response held in memory, with the parts of the AsyncHTTPSRequest
+// interface the response handlers use. Built from a replay log record so
+// the handlers run the same code they do for a live request.
+class ReplayResponse {
+  private:
+    std::unique_ptr<uint8_t[]> body;
+    size_t length;
+    size_t pos = 0;
+    int status;
+    bool gzip;
+
+  public:
+    ReplayResponse(int status, bool gzip, std::unique_ptr<uint8_t[]> body, size_t length)
+      : body(std::move(body)), length(length), status(status), gzip(gzip) {}
+
+    int responseHTTPcode() {
+      return status;
+    }
+
+    const char* respHeaderValue(const char* name) {
+      return gzip && strcasecmp(name, "Content-Encoding") == 0 ? "gzip" : nullptr;
+    }
+
+    String responseText() {
+      String text;
+      if (pos < length) text.concat((const char*) body.get() + pos, length - pos);
+      pos = length;
+      return text;
+    }
+
+    size_t responseRead(uint8_t* buf, size_t len) {
+      len = min(len, length - pos);
+      memcpy(buf, body.get() + pos, len);
+      pos += len;
+      return len;
+    }
+
+    void abort() {
+      pos = length;
+    }
+};
+
+#endif
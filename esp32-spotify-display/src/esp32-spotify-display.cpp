@@ -1,13 +1,19 @@
 #include "spotify-display.h"
 
-DFRobot_ST7789_240x320_HW_SPI screen(TFT_DC, TFT_CS, TFT_RST);
-PlaybackBar playbackBar = PlaybackBar(15, 310, TFT_WIDTH-30, 5, 8, 0.1, 50);
+Screen screen(TFT_DC, TFT_CS, TFT_RST);
+PlaybackBar<Screen> playbackBar;
 WebServer server(80);
+WebSocketsServer pushServer(PUSH_PORT);
 
 AsyncHTTPSRequest httpsAuth;
 AsyncHTTPSRequest httpsSpotify;
 HTTPClient client;
 
+// Written by the AsyncTCP callbacks, picked up by loop()
+Snapshot<SongInfo> songSnapshot;
+Snapshot<AuthInfo> authSnapshot;
+
+// loop() owned copies of the latest snapshots
 SongInfo song;
 AuthInfo auth;
 
@@ -15,12 +21,14 @@ AuthInfo auth;
 // Forces a check on the saved refresh token in flash
 bool accessTokenSet = false;
 bool triedFileToken = false;
-bool readFlag       = false;
-bool newSong        = false;
 bool imageSet       = false;
 bool textSet        = false;
 bool imageDrawFlag  = false;
 
+// Send times of in-flight async requests, for tracing their round trip
+uint32_t authSent    = 0;
+uint32_t spotifySent = 0;
+
 // Connects to the network specified in credentials.h
 void connect(const char* ssid, const char* passphrase)
 {
@@ -39,16 +47,195 @@ void connect(const char* ssid, const char* passphrase)
   #endif
 }
 
+// ------------------------------- RECORD -------------------------------
+
+#ifdef RECORD
+File replayFile;
+ReplayWriter<File> recorder(replayFile);
+// Responses are logged from the AsyncTCP task, knob samples and art from loop()
+std::mutex recordLock;
+
+bool recording()
+{
+  return replayFile && replayFile.size() < REPLAY_MAX_SIZE;
+}
+
+// Passes a finished live response through to the handlers, keeping a copy of
+// the body to log once they are done with it. The handlers read the request
+// itself, so a RECORD build parses exactly what a live one does; bodies longer
+// than REPLAY_BODY_MAX are logged cut short and flagged.
+class RecordingResponse
+{
+  private:
+    AsyncHTTPSRequest* request;
+    std::unique_ptr<uint8_t[]> body;
+    size_t length  = 0;
+    size_t size    = 0;
+    bool truncated = false;
+    bool aborted   = false;
+
+    void keep(const uint8_t* buf, size_t len)
+    {
+      if (length + len > size && size < REPLAY_BODY_MAX)
+      {
+        size_t grown = size ? size : 1024;
+        while (grown < length + len && grown < REPLAY_BODY_MAX) grown *= 2;
+        grown = min(grown, (size_t) REPLAY_BODY_MAX);
+
+        std::unique_ptr<uint8_t[]> next(new (std::nothrow) uint8_t[grown]);
+        if (next)
+        {
+          if (length != 0) memcpy(next.get(), body.get(), length);
+          body.swap(next);
+          size = grown;
+        }
+      }
+
+      size_t kept = min(len, size - length);
+      if (kept != 0) memcpy(body.get() + length, buf, kept);
+      length += kept;
+      if (kept != len) truncated = true;
+    }
+
+  public:
+    explicit RecordingResponse(AsyncHTTPSRequest* request) : request(request) {}
+
+    int responseHTTPcode()
+    {
+      return request->responseHTTPcode();
+    }
+
+    const char* respHeaderValue(const char* name)
+    {
+      return request->respHeaderValue(name);
+    }
+
+    String responseText()
+    {
+      String text = request->responseText();
+      keep((const uint8_t*) text.c_str(), text.length());
+      return text;
+    }
+
+    size_t responseRead(uint8_t* buf, size_t len)
+    {
+      size_t n = request->responseRead(buf, len);
+      keep(buf, n);
+      return n;
+    }
+
+    // Held until the body has been logged
+    void abort()
+    {
+      aborted = true;
+    }
+
+    // Logs the response with whatever of the body the handler left unread
+    void record(uint8_t kind, uint32_t rtt)
+    {
+      uint8_t buf[256];
+      for (size_t n; (n = request->responseRead(buf, sizeof(buf))) > 0;) keep(buf, n);
+
+      const char* encoding = request->respHeaderValue("Content-Encoding");
+      uint8_t flags = encoding && strcmp(encoding, "gzip") == 0 ? REPLAY_GZIP : 0;
+      if (truncated) flags |= REPLAY_TRUNCATED;
+      // Keep tokens out of the log
+      if (kind == REPLAY_AUTH)
+      {
+        replayRedact(body.get(), length, "access_token");
+        replayRedact(body.get(), length, "refresh_token");
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(recordLock);
+        if (recording()) recorder.response(kind, millis(), request->responseHTTPcode(), flags, rtt, body.get(), length);
+      }
+
+      if (aborted) request->abort();
+    }
+};
+
+// Logs the outcome of an art download, with a hash of what landed on flash
+void recordArt(bool done)
+{
+  uint32_t hash   = REPLAY_HASH_INIT;
+  uint32_t length = 0;
+  if (done)
+  {
+    uint8_t buf[256];
+    File f = LittleFS.open(IMG_PATH, "r");
+    for (size_t n; f && (n = f.read(buf, sizeof(buf))) > 0; length += n) hash = replayHash(hash, buf, n);
+    f.close();
+  }
+
+  std::lock_guard<std::mutex> lock(recordLock);
+  if (recording()) recorder.art(millis(), done ? 200 : 0, length, hash);
+}
+
+void webServerHandleReplay()
+{
+  {
+    std::lock_guard<std::mutex> lock(recordLock);
+    replayFile.flush();
+  }
+
+  File f = LittleFS.open(REPLAY_PATH, "r");
+  if (!f)
+  {
+    server.send(404, "text/plain", "");
+    return;
+  }
+
+  server.streamFile(f, "application/octet-stream");
+  f.close();
+}
+#endif
+
+// Volume a raw knob reading sets
+int potVolume(int raw)
+{
+  return 100 - 100 * (raw / (float) 4096);
+}
+
+// Raw knob reading. Logged while recording when it moves past the wobble
+// loop() ignores, taken from the log while replaying, -1 before the log's
+// first sample.
+#ifdef REPLAY
+int replayPot = -1;
+#endif
+#ifdef RECORD
+int recordedPot = -1;
+#endif
+
+int readPot()
+{
+  #ifdef REPLAY
+    return replayPot;
+  #else
+    int value = analogRead(POT);
+    #ifdef RECORD
+      if (recordedPot < 0 || abs(potVolume(value) - potVolume(recordedPot)) > POT_WOBBLE)
+      {
+        recordedPot = value;
+        std::lock_guard<std::mutex> lock(recordLock);
+        if (recording()) recorder.pot(millis(), value);
+      }
+    #endif
+    return value;
+  #endif
+}
+
 // ------------------------------- GET/REFRESH ACCESS TOKENS -------------------------------
 
-void authCB(void* optParam, AsyncHTTPSRequest* request, int readyState)
+// Handles a token response, live or replayed
+template <typename Response>
+void handleAuth(Response* response)
 {
-  // Fail if client isnt finished reading or response failed
-  if (readyState != readyStateDone) return;
-  if (request->responseHTTPcode() != 200) return;
+  if (response->responseHTTPcode() != 200) return;
 
-  StaticJsonDocument<1024> doc;
-  String json = request->responseText();
+  TRACE_SCOPE("authCB");
+  JsonDocument doc;
+  String json = response->responseText();
   DeserializationError err = deserializeJson(doc, json);
 
   if (err)
@@ -61,15 +248,13 @@ void authCB(void* optParam, AsyncHTTPSRequest* request, int readyState)
     return;
   }
 
-  auth.accessToken = doc["access_token"].as<String>();
-  auth.expiry = millis() + 1000 * doc["expires_in"].as<int>();
-  // Refresh token not included in refresh response
-  String refreshToken = doc["refresh_token"].as<String>();
-  // As if spotify sends back a string that says "null" when using refresh token rather than excluding it
-  if (refreshToken != "null")
+  AuthInfo& next = authSnapshot.writeBuffer();
+  readAuth(doc, next);
+  // Refresh token not included in refresh response, empty keeps the one loop() already has
+  if (next.refreshToken.length() != 0)
   {
-    auth.refreshToken = refreshToken;
-
+    // Replayed tokens are redacted, keep the real one on flash
+  #ifndef REPLAY
     // Try to write refresh token to file
     File f = LittleFS.open(TOKEN_PATH, "w");
     if (!f)
@@ -80,16 +265,46 @@ void authCB(void* optParam, AsyncHTTPSRequest* request, int readyState)
       return;
     }
 
-    f.print(auth.refreshToken);
+    f.print(next.refreshToken);
     f.close();
+  #endif
   }
 
-  accessTokenSet = true;
+  authSnapshot.publish();
   #ifdef DEBUG
     Serial.println("Successfully got access tokens!");
   #endif
 }
 
+void authCB(void* optParam, AsyncHTTPSRequest* request, int readyState)
+{
+  // Fail if client isnt finished reading
+  if (readyState != readyStateDone) return;
+  Trace::complete("auth request", authSent, micros());
+
+  #ifdef RECORD
+    RecordingResponse recorded(request);
+    handleAuth(&recorded);
+    recorded.record(REPLAY_AUTH, (micros() - authSent) / 1000);
+  #else
+    handleAuth(request);
+  #endif
+}
+
+// Picks up tokens published by authCB, true if new tokens were set
+bool pollAuth()
+{
+  if (!authSnapshot.update()) return false;
+
+  const AuthInfo& next = authSnapshot.read();
+  auth.accessToken = next.accessToken;
+  auth.expiry      = next.expiry;
+  if (next.refreshToken.length() != 0) auth.refreshToken = next.refreshToken;
+
+  accessTokenSet = true;
+  return true;
+}
+
 bool getAuth(bool refresh, bool fromFile, String code)
 {
   // Attempt to automatically get access token from saved refresh token
@@ -126,6 +341,7 @@ bool getAuth(bool refresh, bool fromFile, String code)
     String authStr = "Basic " + base64::encode(String(CLIENT) + ":" + String(CLIENT_SECRET));
     httpsAuth.setReqHeader("Content-Type", "application/x-www-form-urlencoded");
     httpsAuth.setReqHeader("Authorization", authStr.c_str());
+    authSent = micros();
     httpsAuth.send(body);
     return true;
 
@@ -141,39 +357,58 @@ bool getAuth(bool refresh, bool fromFile, String code)
 
 // ------------------------------- GET CURRENTLY PLAYING -------------------------------
 
-void currentlyPlayingCB(void* optParam, AsyncHTTPSRequest* request, int readyState)
+// Tells loop() nothing is playing, for no active device (204) or no track. The
+// empty id keeps the last song on screen.
+void publishStopped()
 {
-  // Fail if client is not done or response failed
-  if (readyState != readyStateDone) return;
-  if (request->responseHTTPcode() != 200) return;
-
-  String json = request->responseText();
-  DynamicJsonDocument doc(1024);
-  StaticJsonDocument<300> filter;
-
-  JsonObject filter_device            = filter.createNestedObject("device");
-  JsonObject filter_item              = filter.createNestedObject("item");
-  JsonObject filter_item_album        = filter_item.createNestedObject("album");
-  JsonObject filter_item_album_images = filter_item_album["images"].createNestedObject();
-
-  filter["progress_ms"]               = true;
-  filter["is_playing"]                = true;
-  filter_device["volume_percent"]     = true;
-  filter_device["name"]               = true;
-  filter_item["name"]                 = true;
-  filter_item["duration_ms"]          = true;
-  filter_item["artists"][0]["name"]   = true;
-  filter_item["id"]                   = true;
-  filter_item_album["name"]           = true;
-  filter_item_album_images["url"]     = true;
-  filter_item_album_images["width"]   = true;
-  filter_item_album_images["height"]  = true;
-
-  DeserializationError err = deserializeJson(doc, json, DeserializationOption::Filter(filter));
+  // Every field is written, the buffer may hold an older snapshot
+  SongInfo& next = songSnapshot.writeBuffer();
+  next           = SongInfo();
+  next.isPlaying = false;
+  songSnapshot.publish();
+}
+
+// Handles a player response, live or replayed. rtt is the request's round trip in ms.
+template <typename Response>
+void handleCurrentlyPlaying(Response* response, uint32_t rtt)
+{
+  if (response->responseHTTPcode() == 204)
+  {
+    publishStopped();
+    return;
+  }
+  if (response->responseHTTPcode() != 200) return;
+
+  TRACE_SCOPE("currentlyPlayingCB");
+  JsonDocument doc;
+  JsonDocument filter;
+  playerFilter(filter);
+
+  // Inflate gzipped bodies straight into the parser rather than copying them out first
+  DeserializationError err;
+  const char* encoding = response->respHeaderValue("Content-Encoding");
+  if (encoding && strcmp(encoding, "gzip") == 0)
+  {
+    GzipStream body([response](uint8_t* buf, size_t len) { return response->responseRead(buf, len); });
+    if (!body.ok())
+    {
+      #ifdef DEBUG
+        Serial.println("Bad gzip header or no memory for the inflate window");
+      #endif
+      response->abort();
+      return;
+    }
+    err = deserializeJson(doc, body, DeserializationOption::Filter(filter));
+  }
+  else
+  {
+    err = deserializeJson(doc, response->responseText(), DeserializationOption::Filter(filter));
+  }
+
   #ifdef DEBUG
     if (doc.overflowed())
     {
-      Serial.printf("Deserialization rept: Overrun %d, Capacity %zu\n", doc.overflowed(), doc.capacity());
+      Serial.printf("Deserialization rept: Overrun %d, Free heap %lu\n", doc.overflowed(), (unsigned long) ESP.getFreeHeap());
     }
   #endif
 
@@ -183,43 +418,34 @@ void currentlyPlayingCB(void* optParam, AsyncHTTPSRequest* request, int readySta
       Serial.print(F("Deserialisation failed"));
       Serial.println(err.f_str());
     #endif
-    request->abort();
+    response->abort();
     return;
   }
 
-  JsonObject item   = doc["item"];
-  if (item["id"] == NULL) return;
-
-  String prevId     = song.id;
-  JsonObject device = doc["device"];
-  JsonArray images  = item["album"]["images"];
-  song.id           = item["id"].as<String>();
-  song.progressMs   = doc["progress_ms"].as<int>();
-  song.isPlaying    = doc["is_playing"].as<bool>();
-  song.volume       = device["volume_percent"].as<int>();
-  song.deviceName   = device["name"].as<String>();
-  song.songName     = item["name"].as<String>();
-  song.albumName    = item["album"]["name"].as<String>();
-  song.artistName   = item["artists"][0]["name"].as<String>();
-  song.durationMs   = item["duration_ms"].as<int>();
-
-  for (int i = 0; i < images.size(); i++)
+  SongInfo& next = songSnapshot.writeBuffer();
+  if (!readPlayer(doc, next, rtt))
   {
-    int height = images[i]["height"].as<int>();
-    int width  = images[i]["width"].as<int>();
-
-    // Only grab appropriate sized image
-    if (height <= IMG_H * IMG_SCALE && width <= IMG_W * IMG_SCALE)
-    {
-      song.height = height;
-      song.width  = width;
-      song.imgUrl = images[i]["url"].as<String>();
-      break;
-    }
+    publishStopped();
+    return;
   }
 
-  readFlag = true;
-  newSong = song.id != prevId; 
+  songSnapshot.publish();
+}
+
+void currentlyPlayingCB(void* optParam, AsyncHTTPSRequest* request, int readyState)
+{
+  // Fail if client is not done
+  if (readyState != readyStateDone) return;
+  uint32_t rtt = (micros() - spotifySent) / 1000;
+  Trace::complete("currently playing request", spotifySent, micros());
+
+  #ifdef RECORD
+    RecordingResponse recorded(request);
+    handleCurrentlyPlaying(&recorded, rtt);
+    recorded.record(REPLAY_PLAYER, rtt);
+  #else
+    handleCurrentlyPlaying(request, rtt);
+  #endif
 }
 
 bool getCurrentlyPlaying()
@@ -232,7 +458,9 @@ bool getCurrentlyPlaying()
   {
     String authStr = "Bearer " + auth.accessToken;
     httpsSpotify.setReqHeader("Cache-Control", "no-cache");
+    httpsSpotify.setReqHeader("Accept-Encoding", "gzip");
     httpsSpotify.setReqHeader("Authorization", authStr.c_str());
+    spotifySent = micros();
     httpsSpotify.send();
     return true;
   }
@@ -247,10 +475,102 @@ bool getCurrentlyPlaying()
 
 // ------------------------------- GET ALBUM ART -------------------------------
 
-// Synchronous due to large file size limitations
+// Waits for body data, 0 if the connection dropped, stalled for ART_STALL_TIMEOUT
+// or passed the deadline
+int waitForData(WiFiClient* data, uint32_t deadline)
+{
+  uint32_t stallAt = millis() + ART_STALL_TIMEOUT;
+  while (true)
+  {
+    int available = data->available();
+    if (available > 0) return available;
+    if (!data->connected()) return 0;
+    if ((int32_t) (millis() - stallAt) >= 0 || (int32_t) (millis() - deadline) >= 0) return 0;
+
+    // Reset WDT
+    delay(1);
+  }
+}
+
+// Copies len bytes of body into f, or everything until the server closes if len < 0
+bool copyBody(WiFiClient* data, File& f, uint8_t* buf, size_t bufSize, int len, int& offset, uint32_t deadline)
+{
+  int copied = 0;
+  while (len < 0 || copied < len)
+  {
+    int available = waitForData(data, deadline);
+    if (available == 0) return len < 0 && !data->connected();
+
+    size_t want = min((size_t) available, bufSize);
+    if (len >= 0) want = min(want, (size_t) (len - copied));
+
+    int bytes = data->read(buf, want);
+    if (bytes <= 0) continue;
+    if (f.write(buf, bytes) != (size_t) bytes) return false;
+
+    copied += bytes;
+    offset += bytes;
+  }
+
+  return true;
+}
+
+// Reads a CRLF terminated line of a chunked body
+bool readLine(WiFiClient* data, char* line, size_t len, uint32_t deadline)
+{
+  size_t n = 0;
+  while (true)
+  {
+    if (waitForData(data, deadline) == 0) return false;
+
+    char c = data->read();
+    if (c == '\n') break;
+    if (c != '\r' && n < len - 1) line[n++] = c;
+  }
+
+  line[n] = '\0';
+  return true;
+}
+
+// Decodes a chunked body into f
+bool copyChunked(WiFiClient* data, File& f, uint8_t* buf, size_t bufSize, int& offset, uint32_t deadline)
+{
+  char line[32];
+  while (true)
+  {
+    if (!readLine(data, line, sizeof(line), deadline)) return false;
+
+    int chunk = strtol(line, NULL, 16);
+    if (chunk == 0) break;
+    if (!copyBody(data, f, buf, bufSize, chunk, offset, deadline)) return false;
+    // CRLF after chunk data
+    if (!readLine(data, line, sizeof(line), deadline)) return false;
+  }
+
+  // Drain trailers so a reused connection starts clean
+  while (readLine(data, line, sizeof(line), deadline) && line[0] != '\0');
+  return true;
+}
+
+// Art transports, the TLS one gets its handshake timeout from the download deadline
+WiFiClient artClient;
+WiFiClientSecure artTlsClient;
+
+// Partial download left at IMG_PATH by an earlier getAlbumArt(), resumed by the
+// next call for the same image if the server accepts ranges
+String artUrl;
+bool artRanges = false;
+bool artPartial = false;
+
+// Synchronous due to large file size limitations. All attempts share one
+// ART_TIMEOUT deadline, connects and TLS handshakes are cut short by it and a
+// stalled body gives up early. If the connection drops part way and the server
+// accepts ranges, the rest is requested from where it stopped, in this call or
+// a later one.
 bool getAlbumArt()
 {
-  if (!song.imgUrl)
+  TRACE_SCOPE("getAlbumArt");
+  if (song.imgUrl.length() == 0)
   {
     #ifdef DEBUG
       Serial.println("No image url available.");
@@ -258,73 +578,169 @@ bool getAlbumArt()
     return false;
   }
 
-  client.begin(song.imgUrl);
-  client.setTimeout(REQ_TIMEOUT);
-  client.addHeader("Cache-Control", "no-cache");
+  // Pick up where the last call stopped, or start the file over
+  bool resume = artPartial && artRanges && artUrl == song.imgUrl;
+  if (!resume)
+  {
+    artUrl    = song.imgUrl;
+    artRanges = false;
+  }
+  artPartial = false;
+
+  File f;
+  {
+    TRACE_SCOPE("LittleFS open");
+    f = LittleFS.open(IMG_PATH, resume ? "a" : "w");
+  }
 
-  int resp = client.GET();
-  if (resp != 200)
+  if (!f)
   {
     #ifdef DEBUG
-      Serial.printf("An error occurred while getting image %c\nHTTP %d\n", song.imgUrl, resp);
+      Serial.println("Failed to open file descriptor.");
     #endif
-    client.end();
     return false;
   }
 
-  File f = LittleFS.open(IMG_PATH, "w");
-  if (!f)
+  // Use a bigger buffer when the heap can spare it
+  size_t bufSize = constrain(ESP.getMaxAllocHeap() / 8, STREAM_BUF_MIN, STREAM_BUF_MAX);
+  std::unique_ptr<uint8_t[]> buf(new (std::nothrow) uint8_t[bufSize]);
+  if (!buf)
   {
     #ifdef DEBUG
-      Serial.println("Failed to open file descriptor.");
+      Serial.println("Failed to allocate stream buffer.");
     #endif
-    client.end();
+    f.close();
     return false;
   }
 
-  int numBytes = client.getSize();
-  int offset = 0;
-  uint8_t buf[STREAM_BUF_SIZE];
-  Stream* data = client.getStreamPtr();
-  while (offset < numBytes)
+  const char* headers[] = {"Transfer-Encoding", "Accept-Ranges"};
+  int offset = resume ? f.size() : 0;
+  int total = -1;
+  bool done = false;
+  uint32_t deadline = millis() + ART_TIMEOUT;
+  for (int attempt = 0; attempt <= ART_MAX_RESUMES && !done; attempt++)
   {
-    int available = data->available();
-    if (available)
+    if (attempt > 0)
     {
-      int bytes = data->readBytes(buf, min(available, STREAM_BUF_SIZE));
-      f.write(buf, bytes);
-      offset += bytes;
+      // Nothing to retry over, or no time left to back off and try again
+      if (WiFi.status() != WL_CONNECTED) break;
+      uint32_t backoff = ART_RETRY_BACKOFF << (attempt - 1);
+      if ((int32_t) (deadline - millis()) <= (int32_t) backoff) break;
+      delay(backoff);
     }
 
-    // Reset WDT
-    yield();
+    int32_t remaining = deadline - millis();
+    if (song.imgUrl.startsWith("https:"))
+    {
+      artTlsClient.setInsecure();
+      // Whole seconds only, at least one
+      artTlsClient.setHandshakeTimeout(max(remaining / 1000, (int32_t) 1));
+      client.begin(artTlsClient, song.imgUrl);
+    }
+    else
+    {
+      client.begin(artClient, song.imgUrl);
+    }
+    client.setConnectTimeout(min(remaining, (int32_t) ART_CONNECT_TIMEOUT));
+    client.setTimeout(min(remaining, (int32_t) UINT16_MAX));
+    client.addHeader("Cache-Control", "no-cache");
+    client.collectHeaders(headers, 2);
+    if (offset > 0) client.addHeader("Range", "bytes=" + String(offset) + "-");
+
+    int resp;
+    {
+      TRACE_SCOPE("art GET");
+      resp = client.GET();
+    }
+
+    if (resp != 200 && resp != 206)
+    {
+      #ifdef DEBUG
+        Serial.printf("An error occurred while getting image %s\nHTTP %d\n", song.imgUrl.c_str(), resp);
+      #endif
+      client.end();
+      // Dropped before the response arrived, try again
+      if (resp < 0) continue;
+      break;
+    }
+
+    // Server ignored the range, start over
+    if (resp == 200 && offset > 0)
+    {
+      f.close();
+      f = LittleFS.open(IMG_PATH, "w");
+      offset = 0;
+    }
+
+    int numBytes = client.getSize();
+    if (numBytes >= 0) total = offset + numBytes;
+    bool chunked = client.header("Transfer-Encoding").equalsIgnoreCase("chunked");
+    bool ranges  = client.header("Accept-Ranges").equalsIgnoreCase("bytes") || resp == 206;
+    artRanges = ranges;
+
+    WiFiClient* data = client.getStreamPtr();
+    {
+      TRACE_SCOPE("art stream");
+      done = chunked ? copyChunked(data, f, buf.get(), bufSize, offset, deadline)
+                     : copyBody(data, f, buf.get(), bufSize, numBytes, offset, deadline);
+    }
+
+    client.end();
+
+    // Nothing to resume from without range support
+    if (!done && !ranges)
+    {
+      f.close();
+      f = LittleFS.open(IMG_PATH, "w");
+      offset = 0;
+    }
+
+    #ifdef DEBUG
+      if (!done) Serial.printf("Image download interrupted at %d bytes, retrying\n", offset);
+    #endif
   }
 
   f.close();
-  client.end();
+  // Keep what arrived for the next call to resume
+  artPartial = !done && offset > 0 && artRanges;
   #ifdef DEBUG
-    Serial.printf("Wrote to file %d/%d bytes\n", offset, numBytes);
+    Serial.printf("Wrote to file %d/%d bytes\n", offset, total);
   #endif
-  return true;
+  return done;
 }
 
 // ------------------------------- VOLUME CONTROL -------------------------------
 
-void volumeSetCB(void* optParam, AsyncHTTPSRequest* request, int readyState)
+// Handles a volume response, live or replayed
+template <typename Response>
+void handleVolumeSet(Response* response)
 {
-  // Fail if client hasnt finished reading or response failed
-  if (readyState != readyStateDone) return;
-
-  Serial.println("An error occurred: HTTP \n" + request->responseHTTPcode());
-  if (request->responseHTTPcode() != 200)
+  Serial.println("An error occurred: HTTP \n" + response->responseHTTPcode());
+  if (response->responseHTTPcode() != 200)
   {
     #ifdef DEBUG
-      Serial.println("An error occurred: HTTP " + request->responseHTTPcode());
+      Serial.println("An error occurred: HTTP " + response->responseHTTPcode());
     #endif
     return;
   }
 }
 
+void volumeSetCB(void* optParam, AsyncHTTPSRequest* request, int readyState)
+{
+  // Fail if client hasnt finished reading
+  if (readyState != readyStateDone) return;
+  uint32_t rtt = (micros() - spotifySent) / 1000;
+  Trace::complete("volume request", spotifySent, micros());
+
+  #ifdef RECORD
+    RecordingResponse recorded(request);
+    handleVolumeSet(&recorded);
+    recorded.record(REPLAY_VOLUME, rtt);
+  #else
+    handleVolumeSet(request);
+  #endif
+}
+
 bool updateVolume()
 {
   // Fail if client isnt ready
@@ -344,6 +760,7 @@ bool updateVolume()
     httpsSpotify.setReqHeader("Authorization", authStr.c_str());
     httpsSpotify.setReqHeader("Cache-Control", "no-cache");
     httpsSpotify.setReqHeader("Content-Length", "0");
+    spotifySent = micros();
     httpsSpotify.send();
     Serial.printf("curl -X PUT %s -H Authorization: %s -H Cache-Control: no-cache -H Content-Length: 0\n", url.c_str(), authStr.c_str());
     return true;
@@ -359,11 +776,11 @@ bool updateVolume()
 
 // ------------------------------- TEXT -------------------------------
 
-void writeSongText(DFRobot_ST7789_240x320_HW_SPI& screen, uint16_t color)
+void writeSongText(Screen& screen, uint16_t color)
 {
   // Rewrite song/artist text
   screen.setTextSize(2);
-  screen.setCursor(TEXT_X, TEXT_Y);
+  screen.setCursor(DisplayLayout::textX, DisplayLayout::textY);
   screen.print(song.songName);
   screen.setTextSize(1);
   screen.print(song.artistName);
@@ -418,21 +835,21 @@ bool processBmp(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t* bitmap)
   }
 
   // Dont draw gradient if its too dark or covered by the image
-  bool drawBackfill = x == IMG_X || (y == IMG_Y + IMG_H - h && x == IMG_X + IMG_W - w);
+  bool drawBackfill = x == DisplayLayout::imgX || (y == DisplayLayout::imgY + DisplayLayout::imgH - h && x == DisplayLayout::imgX + DisplayLayout::imgW - w);
   if (drawBackfill && r + g + b > GRADIENT_BLACK_THRESHOLD)
   {
-    int yStart = y == IMG_Y ? 0 : y;
-    int yEnd = y == IMG_Y + IMG_H - h && x == IMG_X + IMG_W - w ? 300 : y + h;
+    int yStart = y == DisplayLayout::imgY ? 0 : y;
+    int yEnd = y == DisplayLayout::imgY + DisplayLayout::imgH - h && x == DisplayLayout::imgX + DisplayLayout::imgW - w ? DisplayLayout::contentH : y + h;
     for (int gy = yStart; gy < yEnd; gy++)
     {
-      for (int gx = 0; gx < TFT_WIDTH; gx++)
+      for (int gx = 0; gx < DisplayLayout::tftWidth; gx++)
       {
-        bool overlapX = gx >= IMG_X && gx < IMG_X + IMG_W;
-        bool overlapY = gy >= IMG_Y && gy < IMG_Y + IMG_H;
+        bool overlapX = gx >= DisplayLayout::imgX && gx < DisplayLayout::imgX + DisplayLayout::imgW;
+        bool overlapY = gy >= DisplayLayout::imgY && gy < DisplayLayout::imgY + DisplayLayout::imgH;
 
         if (!(overlapX && overlapY))
         {
-          double grad = (300 - gy - (fast_rand() % 25)) / (double) 300;
+          double grad = (DisplayLayout::contentH - gy - (fast_rand() % 25)) / (double) DisplayLayout::contentH;
           grad = grad < 0 ? 0 : grad;
           uint8_t rGrad = r * grad;
           uint8_t gGrad = g * grad;
@@ -442,11 +859,11 @@ bool processBmp(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t* bitmap)
       }
 
       // Animate playback bar when drawing backfill
-      if (gy < IMG_Y || gy > IMG_Y + IMG_H)
+      if (gy < DisplayLayout::imgY || gy > DisplayLayout::imgY + DisplayLayout::imgH)
         playbackBar.draw(screen, 0);
       
       // Dont overwrite text with background fill
-      if (gy > TEXT_Y)
+      if (gy > DisplayLayout::textY)
         writeSongText(screen, COLOR_RGB565_WHITE);
     }
   }
@@ -458,10 +875,85 @@ bool processBmp(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t* bitmap)
   return true;
 }
 
+// ------------------------------- TRACE -------------------------------
+
+// Dumps the trace ring as chrome trace_event JSON, open in chrome://tracing or ui.perfetto.dev
+void webServerHandleTrace()
+{
+  char buf[512];
+  int len = 0;
+
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "application/json", "{\"traceEvents\":[");
+
+  // Stop recording so the ring isn't overwritten mid dump
+  bool enabled = Trace::enabled;
+  Trace::enabled = false;
+  for (uint32_t i = 0; i < Trace::count(); i++)
+  {
+    int n = Trace::format(i, buf + len, sizeof(buf) - len);
+    if (len + n >= (int) sizeof(buf))
+    {
+      buf[len] = '\0';
+      server.sendContent(buf);
+      len = 0;
+      n = Trace::format(i, buf, sizeof(buf));
+    }
+
+    len += n;
+  }
+
+  Trace::enabled = enabled;
+  if (len != 0) server.sendContent(buf);
+  server.sendContent("]}");
+  server.sendContent("");
+}
+
+// ------------------------------- IDLE -------------------------------
+
+// Drop to idle rates once nothing has happened for a while
+uint32_t lastActive = 0;
+bool     idle       = false;
+
+// Returns to full rate, called on anything the user would notice
+void wake()
+{
+  lastActive = millis();
+  if (!idle) return;
+
+  idle = false;
+  setCpuFrequencyMhz(ACTIVE_CPU_FREQ);
+  #ifdef DEBUG
+    Serial.println("Leaving idle.");
+  #endif
+}
+
+void checkIdle()
+{
+  if (idle || song.isPlaying || millis() - lastActive < IDLE_TIMEOUT) return;
+
+  idle = true;
+  setCpuFrequencyMhz(IDLE_CPU_FREQ);
+  #ifdef DEBUG
+    Serial.println("Entering idle.");
+  #endif
+}
+
+// Blocks until the next idle frame or poll deadline, whichever is first.
+// delay() suspends the loop task so the core sits in the idle task rather
+// than spinning.
+void idleWait(uint32_t lastSongRequest, uint32_t songRequestRate)
+{
+  uint32_t sinceRequest = millis() - lastSongRequest;
+  uint32_t untilPoll = sinceRequest < songRequestRate ? songRequestRate - sinceRequest : 0;
+  delay(min((uint32_t) IDLE_FRAME_RATE, untilPoll));
+}
+
 // ------------------------------- WEBSERVER -------------------------------
 
 void webServerHandleRoot()
 {
+  wake();
   String header = "https://accounts.spotify.com/authorize?client_id=" + String(CLIENT) +
                   "&response_type=code&redirect_uri=http://" + WiFi.localIP().toString() +
                   "/callback&scope=%20user-modify-playback-state%20user-read-currently-playing%20" +
@@ -473,6 +965,7 @@ void webServerHandleRoot()
 
 void webServerHandleCallback()
 {
+  wake();
   if (server.arg("code") != "")
   {
     if (getAuth(/*refresh=*/false, /*fromFile=*/false, server.arg("code")))
@@ -501,11 +994,327 @@ uint32_t lastPotChange    = 0;
 uint32_t lastImgRequest   = 0;
 uint32_t lastVolRequest   = 0;
 uint32_t lastSongRequest  = 0;
+uint32_t lastPush         = 0;
 int      authRefreshFails = 0;
 
+// Process and draw background gradient and album art
+void drawArt()
+{
+  sampleColor = true;
+  TRACE_SCOPE("drawFsJpg");
+  TJpgDec.drawFsJpg(DisplayLayout::imgX, DisplayLayout::imgY, IMG_PATH, LittleFS);
+  imageSet = true;
+}
+
+// The current song held where the bar has got to, for updates that don't carry progress
+SongInfo heldSong()
+{
+  SongInfo next = song;
+  next.progressMs = playbackBar.position();
+  next.receivedAt = millis();
+  return next;
+}
+
+// Updates the display for new playback state from a poll or a push. hasProgress
+// is false for updates whose progress is only heldSong()'s estimate.
+void applySong(const SongInfo& next, bool hasProgress)
+{
+  bool newSong = next.id != song.id;
+  // Spotify moves the timestamp on seeks, skips and play/pause
+  bool jump = newSong || next.timestamp != song.timestamp;
+  bool playChange = next.isPlaying != song.isPlaying;
+  song = next;
+  if (newSong || song.isPlaying) wake();
+  if (newSong)
+  {
+    // Clear album art and song/artist text
+    screen.fillRect(0, 0, DisplayLayout::tftWidth, DisplayLayout::contentH, COLOR_RGB565_BLACK);
+    // Close playback bar wave when switching songs
+    playbackBar.setPlayState(false);
+    // Force draw the playback bar closing animation
+    playbackBar.draw(screen, true);
+    writeSongText(screen, COLOR_RGB565_WHITE);
+    imageSet = false;
+  }
+
+  playbackBar.setTargetAmplitude(song.volume);
+  playbackBar.duration = song.durationMs;
+  playbackBar.setPlayState(song.isPlaying);
+  // Feeding the clock its own estimate would cancel the correction still running
+  // from the last poll; jumps and play state changes snap to it regardless
+  if (hasProgress || jump || playChange) playbackBar.updateProgress(song.progressMs, song.receivedAt, jump);
+  playbackBar.draw(screen, true);
+
+  // Replayed downloads are drawn as their log records come up
+#ifndef REPLAY
+  if (!imageSet && millis() - lastImgRequest > REQ_TIMEOUT && millis() - lastRequest > REQUEST_RATE)
+  {
+    lastImgRequest = millis();
+    lastRequest = lastImgRequest;
+    bool done = getAlbumArt();
+    #ifdef RECORD
+      recordArt(done);
+    #endif
+    if (done) drawArt();
+  }
+#endif
+}
+
+// ------------------------------- PUSH UPDATES -------------------------------
+
+// Playback state pushed by a companion process on the LAN as a JSON text message,
+// all keys optional:
+//   {"id":"<track id>","name":"..","artist":"..","album":"..","img":"<art url>",
+//    "dur":<duration ms>,"prog":<progress ms>,"play":<bool>,"vol":<percent>}
+// A track change must carry name/artist, otherwise a poll is forced to fetch them.
+// Any message, including "{}", counts as a heartbeat for the push channel.
+
+// Applies the keys present in a state message on top of next, false if it is
+// a track change without the track's name. Start from heldSong() so a message
+// without "prog" keeps the clock's estimate rather than the last polled progress.
+bool readState(JsonDocument& doc, SongInfo& next)
+{
+  if (doc["id"].is<const char*>() && doc["id"].as<String>() != next.id)
+  {
+    if (!doc["name"].is<const char*>()) return false;
+
+    next.id         = doc["id"].as<String>();
+    next.songName   = doc["name"].as<String>();
+    next.artistName = doc["artist"] | "";
+    next.albumName  = doc["album"] | "";
+    next.imgUrl     = "";
+    next.height     = 0;
+    next.width      = 0;
+  }
+
+  if (doc["img"].is<const char*>()) next.imgUrl     = doc["img"].as<String>();
+  if (doc["dur"].is<int>())         next.durationMs = doc["dur"].as<int>();
+  if (doc["prog"].is<int>())
+  {
+    next.progressMs = doc["prog"].as<int>();
+    next.receivedAt = millis();
+  }
+  if (doc["play"].is<bool>())       next.isPlaying  = doc["play"].as<bool>();
+  if (doc["vol"].is<int>())         next.volume     = doc["vol"].as<int>();
+  return true;
+}
+
+// Handles messages on the push websocket
+void pushEvent(uint8_t num, WStype_t type, uint8_t* payload, size_t length)
+{
+  if (type != WStype_TEXT) return;
+
+  JsonDocument doc;
+  DeserializationError err = deserializeJson(doc, payload, length);
+  if (err)
+  {
+    #ifdef DEBUG
+      Serial.print("Push deserialisation failed");
+      Serial.println(err.f_str());
+    #endif
+    return;
+  }
+
+  lastPush = millis();
+  // Heartbeat only
+  if (doc.size() == 0) return;
+
+  SongInfo next = heldSong();
+  if (!readState(doc, next))
+  {
+    lastSongRequest = 0;
+    return;
+  }
+
+  applySong(next, doc["prog"].is<int>());
+}
+
+// Polling drops to a slow safety rate while pushes keep arriving
+bool pushHealthy()
+{
+  return lastPush != 0 && millis() - lastPush < PUSH_TIMEOUT;
+}
+
+// ------------------------------- REPLAY -------------------------------
+
+#ifdef REPLAY
+File replayFile;
+ReplayReader<File> replayReader(replayFile);
+ReplayRecord replayNext;
+bool replayPending = false;
+uint32_t replayStart = 0;
+FrameStats replayFrames;
+uint32_t replayMinHeap = UINT32_MAX;
+
+void beginReplay()
+{
+  replayFile = LittleFS.open(REPLAY_PATH, "r");
+  replayPending = replayFile && replayReader.begin() && replayReader.next(replayNext);
+  if (!replayPending) Serial.println("No replay log at " REPLAY_PATH);
+
+  // Tokens come from the log, if at all, so skip logging in
+  accessTokenSet = true;
+  replayStart = millis();
+}
+
+void reportReplay()
+{
+  Serial.printf("Replay finished: %lu frames, mean %lu us, worst %lu us, min free heap %lu\n",
+                (unsigned long) replayFrames.frames, (unsigned long) replayFrames.mean(),
+                (unsigned long) replayFrames.worst, (unsigned long) replayMinHeap);
+}
+
+// Feeds each logged response through the handler its request would have used
+// once its time comes round. The art itself isn't logged, whatever is at
+// IMG_PATH stands in for it.
+void pollReplay()
+{
+  while (replayPending && millis() - replayStart >= replayNext.at)
+  {
+    if (replayNext.kind == REPLAY_POT)
+    {
+      replayPot = replayNext.value;
+    }
+    else if (replayNext.kind == REPLAY_ART)
+    {
+      if (replayNext.status == 200) drawArt();
+    }
+    else
+    {
+      std::unique_ptr<uint8_t[]> body(new (std::nothrow) uint8_t[replayNext.length]);
+      size_t length = 0;
+      while (body && length < replayNext.length)
+      {
+        size_t n = replayReader.body(body.get() + length, replayNext.length - length);
+        if (n == 0) break;
+        length += n;
+      }
+
+      ReplayResponse response(replayNext.status, replayNext.flags & REPLAY_GZIP, std::move(body), length);
+      if (replayNext.flags & REPLAY_TRUNCATED)
+      {
+        // The cut short body would only fail to parse
+        Serial.printf("Skipping truncated response at %lu ms\n", (unsigned long) replayNext.at);
+      }
+      else
+      {
+        switch (replayNext.kind)
+        {
+          case REPLAY_AUTH:   handleAuth(&response); break;
+          case REPLAY_PLAYER: handleCurrentlyPlaying(&response, replayNext.rtt); break;
+          case REPLAY_VOLUME: handleVolumeSet(&response); break;
+        }
+      }
+    }
+
+    replayPending = replayReader.next(replayNext);
+    if (!replayPending) reportReplay();
+  }
+}
+#endif
+
+// ------------------------------- HUB -------------------------------
+
+#ifdef HUB
+// Current playback state for followers, in the same format as pushed updates
+void webServerHandleState()
+{
+  JsonDocument doc;
+  int progress = song.progressMs;
+  if (song.isPlaying) progress = min(progress + (int) (millis() - song.receivedAt), song.durationMs);
+
+  doc["id"]     = song.id;
+  doc["name"]   = song.songName;
+  doc["artist"] = song.artistName;
+  doc["album"]  = song.albumName;
+  doc["dur"]    = song.durationMs;
+  doc["prog"]   = progress;
+  doc["play"]   = song.isPlaying;
+  doc["vol"]    = song.volume;
+
+  // Only advertise art once this song's image is on flash
+  if (imageSet) doc["img"] = "http://" + WiFi.localIP().toString() + "/art.jpg?id=" + song.id;
+
+  String json;
+  serializeJson(doc, json);
+  server.send(200, "application/json", json);
+}
+
+// Cached album art, so followers never touch i.scdn.co
+void webServerHandleArt()
+{
+  File f = LittleFS.open(IMG_PATH, "r");
+  if (!f)
+  {
+    server.send(404, "text/plain", "");
+    return;
+  }
+
+  server.streamFile(f, "image/jpeg");
+  f.close();
+}
+#endif
+
+#ifdef HUB_ADDRESS
+// Backoff after failed hub fetches, so a hub that is down or busy downloading
+// art doesn't hold up the follower's loop every second
+uint32_t hubBackoff  = 0;
+uint32_t lastHubFail = 0;
+
+void hubFailed()
+{
+  lastHubFail = millis();
+  hubBackoff  = hubBackoff == 0 ? FOLLOWER_REQUEST_RATE : min(hubBackoff * 2, (uint32_t) HUB_BACKOFF_MAX);
+}
+
+// Follower: gets playback state from the hub instead of spotify. Synchronous
+// as the hub is on the LAN and the connection is kept alive between requests,
+// with HUB_TIMEOUT bounding how long the loop can stall on it.
+bool getHubState()
+{
+  if (hubBackoff != 0 && millis() - lastHubFail < hubBackoff) return false;
+
+  client.begin("http://" HUB_ADDRESS "/state");
+  client.setConnectTimeout(HUB_TIMEOUT);
+  client.setTimeout(HUB_TIMEOUT);
+
+  int resp = client.GET();
+  if (resp != 200)
+  {
+    #ifdef DEBUG
+      Serial.printf("An error occurred while getting hub state\nHTTP %d\n", resp);
+    #endif
+    client.end();
+    hubFailed();
+    return false;
+  }
+
+  JsonDocument doc;
+  DeserializationError err = deserializeJson(doc, client.getStream());
+  client.end();
+  if (err)
+  {
+    #ifdef DEBUG
+      Serial.print("Hub state deserialisation failed");
+      Serial.println(err.f_str());
+    #endif
+    hubFailed();
+    return false;
+  }
+
+  hubBackoff = 0;
+
+  SongInfo next = heldSong();
+  if (!readState(doc, next)) return false;
+
+  applySong(next, doc["prog"].is<int>());
+  return true;
+}
+#endif
+
 void setup()
 {
-  #ifdef DEBUG
+  #if defined(DEBUG) || defined(REPLAY)
     Serial.begin(9600);
   #endif
 
@@ -530,15 +1339,35 @@ void setup()
   // Initialise webserver for spotify OAuth
   server.on("/", webServerHandleRoot);
   server.on("/callback", webServerHandleCallback);
+  server.on("/trace", webServerHandleTrace);
+  #ifdef RECORD
+    server.on("/replay", webServerHandleReplay);
+  #endif
+  #ifdef HUB
+    server.on("/state", webServerHandleState);
+    server.on("/art.jpg", webServerHandleArt);
+  #endif
   server.begin();
 
+  // Initialise websocket for pushed playback state
+  pushServer.begin();
+  pushServer.onEvent(pushEvent);
+
   // Setup TJpg settings
   TJpgDec.setCallback(processBmp);
-  TJpgDec.setJpgScale(IMG_SCALE);
+  TJpgDec.setJpgScale(DisplayLayout::imgScale);
 
   httpsAuth.onReadyStateChange(authCB);
 
   client.setReuse(true);
+
+  #ifdef RECORD
+    replayFile = LittleFS.open(REPLAY_PATH, "w");
+    if (replayFile) recorder.begin(millis());
+  #endif
+  #ifdef REPLAY
+    beginReplay();
+  #endif
 }
 
 void loop()
@@ -554,15 +1383,23 @@ void loop()
     connect(SSID, PASSPHRASE);
   }
 
+  #ifdef REPLAY
+    uint32_t frameStart = micros();
+    pollReplay();
+  #endif
+
   server.handleClient();
+  pushServer.loop();
   yield();
+  pollAuth();
 
+#if !defined(HUB_ADDRESS) && !defined(REPLAY)
   if (!accessTokenSet && !triedFileToken)
   {
     if (getAuth(/*refresh=*/true, /*fromFile=*/true, ""))
     {
       uint32_t timeout = millis() + REQ_TIMEOUT;
-      while (!triedFileToken && timeout > millis()) yield();
+      while (!pollAuth() && timeout > millis()) yield();
     }
   #ifdef DEBUG
     else
@@ -580,8 +1417,8 @@ void loop()
     getAuth(/*refresh=*/true, /*fromFile=*/false, "");
     accessTokenSet = false;
     uint32_t timeout = millis() + REQ_TIMEOUT;
-    while (!accessTokenSet)
-    {    
+    while (!pollAuth())
+    {
       // Attempt authorisation refresh next iteration if timedout
       if (timeout < millis())
       {
@@ -593,7 +1430,6 @@ void loop()
       yield();
     }
 
-    accessTokenSet = true;
     authRefreshFails = 0;
   }
 
@@ -606,15 +1442,21 @@ void loop()
     screen.print("Visit \nhttp://" + WiFi.localIP().toString() + "\nto log in :)\n");
     return;
   }
+#endif
 
-  // Read potentiometer value at fixed interval
-  if (millis() - lastPotRead > POT_READ_RATE)
+  bool forceFetch = false;
+  // Followers leave the knob alone, volume belongs to whoever owns the hub
+#ifndef HUB_ADDRESS
+  // Read potentiometer value at fixed interval, every frame while idle so turning it wakes immediately
+  if (idle || millis() - lastPotRead > POT_READ_RATE)
   {
-    int newVol = 100 - 100 * (analogRead(POT) / (float) 4096);
+    int raw = readPot();
+    int newVol = potVolume(raw);
 
     // Account for pot wobble
-    if (abs(song.volume - newVol) > 2)
+    if (raw >= 0 && abs(song.volume - newVol) > POT_WOBBLE)
     {
+      wake();
       lastPotChange = millis();
       song.volume = newVol;
       playbackBar.setTargetAmplitude(song.volume);
@@ -623,7 +1465,6 @@ void loop()
     lastPotRead = millis();
   }
 
-  bool forceFetch = false;
   // Only send api POST when pot hasnt changed for a while
   if (lastPotChange != 0 && millis() - lastPotChange > POT_WAIT && millis() - lastVolRequest > SONG_REQUEST_RATE && millis() - lastRequest > REQUEST_RATE)
   {
@@ -631,56 +1472,57 @@ void loop()
     lastPotChange = 0;
     lastVolRequest = millis();
     lastRequest = lastVolRequest;
-    updateVolume();
+    // Replayed responses come from the log
+    #ifndef REPLAY
+      updateVolume();
+    #endif
     yield();
   }
-
-  if (forceFetch || millis() - lastSongRequest > SONG_REQUEST_RATE && millis() - lastRequest > REQUEST_RATE)
+#endif
+
+#ifdef HUB_ADDRESS
+  uint32_t songRequestRate = idle ? IDLE_SONG_REQUEST_RATE : FOLLOWER_REQUEST_RATE;
+#else
+  uint32_t songRequestRate = pushHealthy() ? PUSH_SAFETY_REQUEST_RATE : idle ? IDLE_SONG_REQUEST_RATE : SONG_REQUEST_RATE;
+#endif
+  if (forceFetch || millis() - lastSongRequest > songRequestRate && millis() - lastRequest > REQUEST_RATE)
   {
     #ifdef DEBUG
       Serial.printf("\nStack:%d,Heap:%lu\n", uxTaskGetStackHighWaterMark(NULL), (unsigned long) ESP.getFreeHeap());
     #endif
     lastSongRequest = millis();
     lastRequest = lastSongRequest;
-    getCurrentlyPlaying();
+    #if defined(HUB_ADDRESS)
+      getHubState();
+    #elif !defined(REPLAY)
+      getCurrentlyPlaying();
+    #endif
     yield();
   }
 
-  if (readFlag)
+  if (songSnapshot.update())
   {
-    readFlag = false;
-    if (newSong)
+    const SongInfo& next = songSnapshot.read();
+    if (next.id.length() != 0)
     {
-      // Clear album art and song/artist text
-      screen.fillRect(0, 0, TFT_WIDTH, 300, COLOR_RGB565_BLACK);
-      // Close playback bar wave when switching songs
-      playbackBar.setPlayState(false);
-      // Force draw the playback bar closing animation
-      playbackBar.draw(screen, true);
-      writeSongText(screen, COLOR_RGB565_WHITE);
-      newSong  = false;
-      imageSet = false;
+      applySong(next, true);
     }
-
-    playbackBar.setTargetAmplitude(song.volume);
-    playbackBar.duration = song.durationMs;
-    playbackBar.updateProgress(song.progressMs);
-    playbackBar.setPlayState(song.isPlaying);
-    playbackBar.draw(screen, true);
-
-    if (!imageSet && millis() - lastImgRequest > REQ_TIMEOUT && millis() - lastRequest > REQUEST_RATE)
+    else if (song.isPlaying)
     {
-      lastImgRequest = millis();
-      lastRequest = lastImgRequest;
-      if (getAlbumArt())
-      {
-        // Process and draw background gradient and album art
-        sampleColor = true;
-        TJpgDec.drawFsJpg(IMG_X, IMG_Y, IMG_PATH, LittleFS);
-        imageSet = true;
-      }
+      // Nothing playing anywhere, stop the bar so the display can idle
+      SongInfo stopped = heldSong();
+      stopped.isPlaying = false;
+      applySong(stopped, false);
     }
   }
 
   playbackBar.draw(screen, false);
+
+  #ifdef REPLAY
+    replayFrames.add(micros() - frameStart);
+    replayMinHeap = min(replayMinHeap, (uint32_t) ESP.getFreeHeap());
+  #endif
+
+  checkIdle();
+  if (idle) idleWait(lastSongRequest, songRequestRate);
 }
\ No newline at end of file
@@ -1,13 +1,19 @@
 #include <Arduino.h>
 #include "DFRobot_GDL.h"
 #include "credentials.h"
+#include "DisplayLayout.h"
 #include "PlaybackBar.h"
+#include "Snapshot.h"
+#include "Replay.h"
+#include "SpotifyJson.h"
 
 #define FORMAT_LITTLEFS_ON_FAIL true
 #include "LittleFS.h"
 #include <TJpg_Decoder.h>
 #include <ArduinoJson.h>
 #include <base64.h>
+#include <memory>
+#include <mutex>
 
 #define DEBUG
 
@@ -27,12 +33,17 @@
   #include <AsyncHTTPSRequest_Generic.h>
   #include <WiFi.h>
   #include <HTTPClient.h>
+  #include <WiFiClientSecure.h>
   #include <WebServer.h>
+  #include <WebSocketsServer.h>
+  #include "GzipStream.h"
+  #include "ReplayResponse.h"
 #endif
 
 #define POT                       A3
 #define POT_READ_RATE             400        // ms
 #define POT_WAIT                  1000       // ms
+#define POT_WOBBLE                2          // volume steps of knob noise to ignore
 #define TFT_CS                    15         // D6
 #define TFT_RST                   2          // D5
 #define TFT_DC                    4          // D4
@@ -40,19 +51,45 @@
 #define REQUEST_RATE              200        // ms
 #define MAX_AUTH_REFRESH_FAILS    3
 #define IMG_PATH                  "/img.jpg"
-#define STREAM_BUF_SIZE           128
+#define STREAM_BUF_MIN            128
+#define STREAM_BUF_MAX            4096
+#define ART_STALL_TIMEOUT         500        // ms without data before retrying
+#define ART_MAX_RESUMES           3
+#define ART_TIMEOUT               3000       // ms for the whole download, retries included
+#define ART_CONNECT_TIMEOUT       1000       // ms
+#define ART_RETRY_BACKOFF         100        // ms before the first retry, doubling after
 #define TOKEN_PATH                "/token.txt"
 #define REQ_TIMEOUT               5000       // ms
-#define TFT_WIDTH                 240
-#define TFT_HEIGHT                320
-#define IMG_Y                     40
-#define IMG_X                     45
-#define IMG_SCALE                 2
-#define IMG_W                     150
-#define IMG_H                     150
-#define TEXT_Y                    240
-#define TEXT_X                    0
 #define GRADIENT_BLACK_THRESHOLD  5
+#define IDLE_TIMEOUT              60000      // ms paused before dropping to idle rates
+#define IDLE_SONG_REQUEST_RATE    30000      // ms
+#define IDLE_FRAME_RATE           200        // ms
+#define IDLE_CPU_FREQ             80         // MHz
+#define ACTIVE_CPU_FREQ           240        // MHz
+#define PUSH_PORT                 81
+#define PUSH_TIMEOUT              30000      // ms without a push before falling back to polling
+#define PUSH_SAFETY_REQUEST_RATE  60000      // ms
+#define FOLLOWER_REQUEST_RATE     1000       // ms
+#define HUB_TIMEOUT               300        // ms, connect and read timeout for hub fetches
+#define HUB_BACKOFF_MAX           30000      // ms between hub fetches while it is unreachable
+
+// Fleet mode, leave both undefined for a standalone display
+// #define HUB                                      // Also serve playback state and art to followers
+// #define HUB_ADDRESS               "192.168.1.2"  // Follow this hub instead of polling spotify
+
+// Field capture, see Replay.h. RECORD logs responses and knob input to REPLAY_PATH,
+// fetch it from /replay. REPLAY plays that log back instead of using the network.
+// #define RECORD
+// #define REPLAY
+#define REPLAY_PATH               "/replay.bin"
+#define REPLAY_MAX_SIZE           262144     // bytes of log before capture stops
+#define REPLAY_BODY_MAX           32768      // bytes, longer bodies are logged truncated and skipped on replay
+
+#if defined(REPLAY) && (defined(RECORD) || defined(HUB_ADDRESS))
+  #error "REPLAY drives the display from a log, it can't be combined with RECORD or HUB_ADDRESS"
+#endif
+
+using Screen = DFRobot_ST7789_240x320_HW_SPI;
 
 struct SongInfo {
   // General song info
@@ -69,6 +106,8 @@ struct SongInfo {
   // Playback info
   int durationMs;
   int progressMs;
+  uint32_t receivedAt;   // millis() progressMs was valid at
+  uint64_t timestamp;    // Spotify's last state change, unix ms
   int volume;
   String deviceName;
   bool isPlaying;
@@ -0,0 +1,19 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+#include <stdint.h>
+#include <stdlib.h>
+#include <algorithm>
+
+// Just enough of Arduino.h for the SpotifyDisplayCommon headers. Time is
+// virtual, host programs move it forward themselves.
+namespace host {
+  inline uint64_t nowUs = 0;
+}
+
+inline uint32_t millis() { return host::nowUs / 1000; }
+inline uint32_t micros() { return host::nowUs; }
+
+using std::min;
+using std::max;
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef HOST_SUPPORT_H
+#define HOST_SUPPORT_H
+#include <ArduinoJson.h>
+#include <chrono>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string>
+
+// Stands in for the TFT, counting the pixels each draw would push over SPI
+struct CountingScreen {
+  uint64_t pixels = 0;
+
+  void drawPixel(int16_t x, int16_t y, uint16_t color) { pixels++; }
+  void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) { pixels += h; }
+  void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) { pixels += w; }
+};
+
+// The device's SongInfo and AuthInfo with std::string text, for the shared
+// readers in SpotifyJson.h
+struct SongInfo {
+  std::string songName;
+  std::string artistName;
+  std::string albumName;
+  std::string id;
+
+  std::string imgUrl;
+  uint16_t height = 0;
+  uint16_t width  = 0;
+
+  int durationMs      = 0;
+  int progressMs      = 0;
+  uint32_t receivedAt = 0;
+  uint64_t timestamp  = 0;
+  int volume          = 0;
+  std::string deviceName;
+  bool isPlaying      = false;
+};
+
+struct AuthInfo {
+  std::string accessToken;
+  std::string refreshToken;
+  int expiry = 0;
+};
+
+// Tracks the live and peak bytes JsonDocuments allocate
+class CountingAllocator : public ArduinoJson::Allocator {
+  private:
+    // Room for the size ahead of each block, keeping alignment
+    static constexpr size_t HEADER = alignof(max_align_t);
+
+  public:
+    size_t current = 0;
+    size_t peak    = 0;
+
+    void* allocate(size_t size) override {
+      uint8_t* p = (uint8_t*) malloc(size + HEADER);
+      if (!p) return nullptr;
+
+      *(size_t*) p = size;
+      current += size;
+      if (current > peak) peak = current;
+      return p + HEADER;
+    }
+
+    void deallocate(void* ptr) override {
+      if (!ptr) return;
+      uint8_t* p = (uint8_t*) ptr - HEADER;
+      current -= *(size_t*) p;
+      free(p);
+    }
+
+    void* reallocate(void* ptr, size_t size) override {
+      if (!ptr) return allocate(size);
+
+      uint8_t* p = (uint8_t*) ptr - HEADER;
+      size_t old = *(size_t*) p;
+      p = (uint8_t*) realloc(p, size + HEADER);
+      if (!p) return nullptr;
+
+      *(size_t*) p = size;
+      current += size - old;
+      if (current > peak) peak = current;
+      return p + HEADER;
+    }
+
+    void reset() {
+      peak = current;
+    }
+};
+
+// Wall clock microseconds, for timing host work independent of the virtual millis()
+inline uint64_t wallUs() {
+  using namespace std::chrono;
+  return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+#endif
@@ -0,0 +1,6 @@
+# Builds 32 bit like the ESP32, so ArduinoJson sizes its slots and pools the
+# same way. build_flags only reach the compiler, the linker needs it too.
+# Needs a multilib toolchain, e.g. gcc-multilib/g++-multilib on Debian.
+Import("env")
+
+env.Append(CCFLAGS=["-m32"], LINKFLAGS=["-m32"])
@@ -0,0 +1,105 @@
+#include <ArduinoJson.h>
+#include <SpotifyJson.h>
+#include <stdio.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "HostSupport.h"
+
+// Parses every payload in a corpus directory the way the device handlers do
+// and reports what it costs. player_* files go through the player filter,
+// auth_* files are parsed whole. Files with "malformed" in the name must fail
+// to parse; everything else must parse within the device's heap budget.
+//
+// Memory is the peak of what ArduinoJson allocates, filter included, pools and
+// all. Slots, pools and string headers are sized by pointer width, so the
+// bench is built 32 bit and its numbers are what the ESP32 allocates.
+
+#define BENCH_MIN_RUNS 10
+#define BENCH_MIN_US   20000
+
+static_assert(sizeof(void*) == 4, "Build the bench 32 bit (see m32.py) so allocations match the ESP32");
+
+struct Kind {
+  const char* prefix;
+  size_t budget;     // Heap the parse may take on the ESP32, bytes
+  bool filtered;
+};
+
+static const Kind KINDS[] = {
+  {"player_", PLAYER_HEAP_BUDGET, true},
+  {"auth_",   AUTH_HEAP_BUDGET,   false},
+};
+
+static DeserializationError parse(const Kind& kind, const std::string& json, JsonDocument& doc, JsonDocument& filter) {
+  if (kind.filtered) return deserializeJson(doc, json, DeserializationOption::Filter(filter));
+  return deserializeJson(doc, json);
+}
+
+int main(int argc, char** argv) {
+  const char* dir = argc > 1 ? argv[1] : "corpus";
+  std::vector<std::filesystem::path> files;
+  for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+    if (entry.path().extension() == ".json") files.push_back(entry.path());
+  }
+  std::sort(files.begin(), files.end());
+
+  if (files.empty()) {
+    fprintf(stderr, "No .json payloads in %s\n", dir);
+    return 1;
+  }
+
+  JsonDocument filter;
+  playerFilter(filter);
+
+  printf("%-32s %7s %9s %9s %7s %s\n", "payload", "bytes", "parse_us", "heap", "budget", "result");
+  int failures = 0;
+  for (const auto& path : files) {
+    std::string name = path.filename().string();
+    const Kind* kind = nullptr;
+    for (const Kind& k : KINDS) {
+      if (name.rfind(k.prefix, 0) == 0) kind = &k;
+    }
+    if (!kind) continue;
+
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    std::string json = ss.str();
+
+    // Peak heap, with the filter built alongside the document as the handler does
+    CountingAllocator allocator;
+    DeserializationError err;
+    {
+      JsonDocument ownFilter(&allocator);
+      if (kind->filtered) playerFilter(ownFilter);
+      JsonDocument doc(&allocator);
+      err = parse(*kind, json, doc, ownFilter);
+    }
+    size_t heap = allocator.peak;
+
+    // Average over enough runs to get past timer resolution
+    uint32_t runs = 0;
+    uint64_t start = wallUs();
+    uint64_t elapsed = 0;
+    while (runs < BENCH_MIN_RUNS || elapsed < BENCH_MIN_US) {
+      JsonDocument doc(&allocator);
+      parse(*kind, json, doc, filter);
+      runs++;
+      elapsed = wallUs() - start;
+    }
+
+    bool malformed = name.find("malformed") != std::string::npos;
+    bool ok = malformed ? (bool) err : !err && heap <= kind->budget;
+    if (!ok) failures++;
+
+    printf("%-32s %7zu %9.2f %9zu %7zu %s%s%s\n", name.c_str(), json.size(), (double) elapsed / runs, heap,
+           kind->budget, ok ? "ok" : "FAIL", err ? " " : "", err ? err.c_str() : "");
+  }
+
+  if (failures) printf("\n%d payload(s) failed\n", failures);
+  return failures ? 1 : 0;
+}
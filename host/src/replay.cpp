@@ -0,0 +1,212 @@
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <PlaybackBar.h>
+#include <SpotifyJson.h>
+#include <Replay.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <zlib.h>
+#include "HostSupport.h"
+
+// Plays a capture from a RECORD build through the shared parse and playback bar
+// code, making the same updates the device's handlers, applySong() and loop()
+// do. Virtual time follows the log; parse and frame costs are wall clock on the
+// host, so compare runs on the same machine rather than against the device.
+
+struct FileIn {
+  FILE* f;
+  size_t read(uint8_t* buf, size_t len) { return fread(buf, 1, len, f); }
+};
+
+struct ParseStats {
+  uint32_t count = 0;
+  uint64_t total = 0;   // us
+  uint32_t worst = 0;   // us
+  size_t   peak  = 0;   // bytes
+
+  void add(uint32_t us, size_t bytes) {
+    count++;
+    total += us;
+    if (us > worst) worst = us;
+    if (bytes > peak) peak = bytes;
+  }
+};
+
+static const char* KIND_NAMES[] = {"?", "auth", "player", "volume", "art", "pot"};
+
+// Display state the log drives, as loop() holds it
+struct Display {
+  CountingScreen screen;
+  PlaybackBar<CountingScreen> bar;
+  SongInfo song;
+
+  // Same updates as applySong()
+  void apply(const SongInfo& next, bool hasProgress) {
+    bool newSong = next.id != song.id;
+    bool jump = newSong || next.timestamp != song.timestamp;
+    bool playChange = next.isPlaying != song.isPlaying;
+    song = next;
+    if (newSong) {
+      bar.setPlayState(false);
+      bar.draw(screen, true);
+    }
+
+    bar.setTargetAmplitude(song.volume);
+    bar.duration = song.durationMs;
+    bar.setPlayState(song.isPlaying);
+    if (hasProgress || jump || playChange) bar.updateProgress(song.progressMs, song.receivedAt, jump);
+    bar.draw(screen, true);
+  }
+
+  // Nothing playing, as loop() handles publishStopped()
+  void stop() {
+    if (!song.isPlaying) return;
+
+    SongInfo stopped = song;
+    stopped.progressMs = bar.position();
+    stopped.receivedAt = millis();
+    stopped.isPlaying  = false;
+    apply(stopped, false);
+  }
+};
+
+// Inflates a captured gzip body, empty if it is corrupt
+static std::string gunzip(const std::vector<uint8_t>& body) {
+  std::string out;
+  z_stream zs = {};
+  // 16 + MAX_WBITS expects a gzip header
+  if (inflateInit2(&zs, 16 + MAX_WBITS) != Z_OK) return out;
+
+  zs.next_in  = (Bytef*) body.data();
+  zs.avail_in = body.size();
+  char buf[1024];
+  int status;
+  do {
+    zs.next_out  = (Bytef*) buf;
+    zs.avail_out = sizeof(buf);
+    status = inflate(&zs, Z_NO_FLUSH);
+    out.append(buf, sizeof(buf) - zs.avail_out);
+  } while (status == Z_OK);
+
+  inflateEnd(&zs);
+  if (status != Z_STREAM_END) out.clear();
+  return out;
+}
+
+int main(int argc, char** argv) {
+  if (argc != 2) {
+    fprintf(stderr, "usage: %s <replay.bin>\n", argv[0]);
+    return 2;
+  }
+
+  FILE* f = fopen(argv[1], "rb");
+  if (!f) {
+    perror(argv[1]);
+    return 1;
+  }
+
+  FileIn in = {f};
+  ReplayReader<FileIn> reader(in);
+  if (!reader.begin()) {
+    fprintf(stderr, "%s is not a version %d replay log\n", argv[1], REPLAY_VERSION);
+    return 1;
+  }
+
+  Display display;
+  CountingAllocator allocator;
+  FrameStats frames;
+  ParseStats playerParse;
+  ParseStats authParse;
+
+  AuthInfo auth;
+
+  ReplayRecord rec;
+  printf("at_ms\tkind\tstatus\tbytes\tparse_us\tjson_bytes\tnote\n");
+  while (reader.next(rec)) {
+    // Frames up to this record, at the rate loop() draws them
+    for (uint32_t t = millis() + PlaybackBarGeometry::drawRateMs; t <= rec.at; t += PlaybackBarGeometry::drawRateMs) {
+      host::nowUs = (uint64_t) t * 1000;
+      uint64_t start = wallUs();
+      display.bar.draw(display.screen, false);
+      frames.add(wallUs() - start);
+    }
+    host::nowUs = (uint64_t) rec.at * 1000;
+
+    if (rec.kind == REPLAY_POT) {
+      // Same wobble filter as loop()
+      int newVol = 100 - 100 * (rec.value / (float) 4096);
+      if (abs(display.song.volume - newVol) > 2) {
+        display.song.volume = newVol;
+        display.bar.setTargetAmplitude(newVol);
+      }
+      continue;
+    }
+
+    if (rec.kind == REPLAY_ART) {
+      printf("%u\tart\t%d\t%u\t\t\t%08x\n", rec.at, rec.status, rec.length, rec.hash);
+      continue;
+    }
+
+    std::vector<uint8_t> body(rec.length);
+    size_t length = 0;
+    for (size_t n; length < body.size() && (n = reader.body(body.data() + length, body.size() - length)) > 0;) length += n;
+    body.resize(length);
+
+    if (rec.flags & REPLAY_TRUNCATED) {
+      printf("%u\t%s\t%d\t%zu\t\t\ttruncated, skipped\n", rec.at, KIND_NAMES[rec.kind], rec.status, length);
+      continue;
+    }
+
+    if (rec.kind == REPLAY_PLAYER && rec.status == 204) display.stop();
+    if (rec.status != 200 || rec.kind == REPLAY_VOLUME) {
+      printf("%u\t%s\t%d\t%zu\n", rec.at, KIND_NAMES[rec.kind], rec.status, length);
+      continue;
+    }
+
+    std::string json = rec.flags & REPLAY_GZIP ? gunzip(body) : std::string(body.begin(), body.end());
+    JsonDocument doc(&allocator);
+    allocator.reset();
+    DeserializationError err;
+    uint64_t start = wallUs();
+    if (rec.kind == REPLAY_PLAYER) {
+      JsonDocument filter;
+      playerFilter(filter);
+      err = deserializeJson(doc, json, DeserializationOption::Filter(filter));
+    } else {
+      err = deserializeJson(doc, json);
+    }
+    uint32_t us = wallUs() - start;
+
+    (rec.kind == REPLAY_PLAYER ? playerParse : authParse).add(us, allocator.peak);
+    if (err) {
+      printf("%u\t%s\t%d\t%zu\t%u\t%zu\t%s\n", rec.at, KIND_NAMES[rec.kind], rec.status, length, us, allocator.peak, err.c_str());
+      continue;
+    }
+
+    std::string note;
+    if (rec.kind == REPLAY_AUTH) {
+      readAuth(doc, auth);
+      note = "expires in " + std::to_string(auth.expiry - (int) millis()) + " ms";
+    } else {
+      SongInfo next;
+      if (readPlayer(doc, next, rec.rtt)) {
+        if (next.id != display.song.id) note = next.imgUrl.empty() ? "new song, no art" : "new song, art " + std::to_string(next.width) + "x" + std::to_string(next.height);
+        display.apply(next, true);
+      } else {
+        note = "nothing playing";
+        display.stop();
+      }
+    }
+    printf("%u\t%s\t%d\t%zu\t%u\t%zu\t%s\n", rec.at, KIND_NAMES[rec.kind], rec.status, length, us, allocator.peak, note.c_str());
+  }
+
+  fclose(f);
+  printf("\n%u frames over %u ms: mean %u us, worst %u us, %.1f pixels/frame\n",
+         frames.frames, millis(), frames.mean(), frames.worst, frames.frames ? (double) display.screen.pixels / frames.frames : 0.0);
+  printf("player parses: %u, mean %u us, worst %u us, peak %zu bytes\n", playerParse.count,
+         playerParse.count ? (uint32_t) (playerParse.total / playerParse.count) : 0, playerParse.worst, playerParse.peak);
+  printf("auth parses: %u, mean %u us, worst %u us, peak %zu bytes\n", authParse.count,
+         authParse.count ? (uint32_t) (authParse.total / authParse.count) : 0, authParse.worst, authParse.peak);
+  return 0;
+}
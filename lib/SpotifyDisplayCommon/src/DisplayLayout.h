@@ -0,0 +1,39 @@
+#ifndef DISPLAYLAYOUT_H
+#define DISPLAYLAYOUT_H
+#include <stdint.h>
+
+// Screen layout for the 240x320 ST7789 panel used by both boards
+struct DisplayLayout {
+  static constexpr int16_t tftWidth   = 240;
+  static constexpr int16_t tftHeight  = 320;
+
+  // Album art, drawn from a jpeg scaled down by imgScale
+  static constexpr int16_t imgX       = 45;
+  static constexpr int16_t imgY       = 40;
+  static constexpr int16_t imgW       = 150;
+  static constexpr int16_t imgH       = 150;
+  static constexpr uint8_t imgScale   = 2;
+
+  // Song/artist text
+  static constexpr int16_t textX      = 0;
+  static constexpr int16_t textY      = 240;
+
+  // Everything above the playback bar, cleared on song change
+  static constexpr int16_t contentH   = 300;
+};
+
+// Playback bar sitting along the bottom of the screen
+struct PlaybackBarGeometry {
+  static constexpr int16_t  x           = 15;
+  static constexpr int16_t  y           = 310;
+  static constexpr int16_t  width       = DisplayLayout::tftWidth - 30;
+  static constexpr int16_t  height      = 5;
+  static constexpr int16_t  amplitude   = 8;
+  static constexpr float    period      = 0.1;      // rad/px
+  static constexpr uint32_t drawRateMs  = 50;
+  static constexpr int      amplitudeD  = 4;        // % per frame
+  static constexpr uint16_t color       = 0xFFFF;   // RGB565 white
+  static constexpr uint16_t background  = 0x0000;   // RGB565 black
+};
+
+#endif
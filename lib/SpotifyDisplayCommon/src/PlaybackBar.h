@@ -0,0 +1,115 @@
+#ifndef PLAYBACKBAR_H
+#define PLAYBACKBAR_H
+#include <Arduino.h>
+#include "DisplayLayout.h"
+#include "PlaybackClock.h"
+#include "Trace.h"
+
+// One period of sin scaled to +-127, indexed by phase in 1/64ths of a turn
+static constexpr int8_t WAVE_TABLE[64] = {
+     0,   12,   25,   37,   49,   60,   71,   81,   90,   98,  106,  112,  117,  122,  125,  126,
+   127,  126,  125,  122,  117,  112,  106,   98,   90,   81,   71,   60,   49,   37,   25,   12,
+     0,  -12,  -25,  -37,  -49,  -60,  -71,  -81,  -90,  -98, -106, -112, -117, -122, -125, -126,
+  -127, -126, -125, -122, -117, -112, -106,  -98,  -90,  -81,  -71,  -60,  -49,  -37,  -25,  -12
+};
+
+// Animated wave progress bar. Display is any type providing the GFX style
+// drawPixel/drawFastVLine/drawFastHLine calls. They are called qualified with
+// Display, which binds them statically to that class's versions and skips the
+// GFX vtable even though the screen classes aren't final, so the screen passed
+// in must be a Display and not something derived from it. All geometry and
+// colour comes from Geometry at compile time.
+template <typename Display, typename Geometry = PlaybackBarGeometry>
+class PlaybackBar {
+  private:
+    // Phase advance per pixel in 8.8 fixed point table steps
+    static constexpr uint32_t phaseStep = Geometry::period * 64 * 256 / (2 * 3.14159265f) + 0.5f;
+
+    bool playing = 1;
+    int amplitudePercent = 0;
+    int prevAmplitude = 0;
+    int targetAmplitudePercent = 0;
+    int prevBound = Geometry::x;
+    uint32_t curTime = 0;
+    uint32_t lastDraw = 0;
+    PlaybackClock clock;
+
+    static int16_t waveY(uint32_t phase, int amp) {
+      return Geometry::y + ((amp * WAVE_TABLE[(phase >> 8) & 63]) >> 7);
+    }
+
+  public:
+    int progress = 0;
+    int duration = 1;
+
+    void draw(Display& screen, bool force) {
+      if (!force && !playing && amplitudePercent == 0) return;
+      // Limit draw rate to improve frame time consistency
+      if (!force && (millis() - lastDraw < Geometry::drawRateMs)) return;
+      lastDraw = millis();
+      TRACE_SCOPE("PlaybackBar::draw");
+
+      if (playing) {
+        progress = max(0, min((int) clock.position(millis()), duration));
+      }
+
+      // Slowly change amplitude of playback bar wave
+      int target = playing ? targetAmplitudePercent : 0;
+      if (amplitudePercent != target) {
+        int inc = abs(amplitudePercent - target) > Geometry::amplitudeD ? Geometry::amplitudeD : 1;
+        inc *= amplitudePercent > target ? -1 : 1;
+        amplitudePercent += inc;
+      }
+
+      int curAmplitude = Geometry::amplitude * amplitudePercent / 100;
+      int bound = Geometry::x + (int) ((int64_t) Geometry::width * progress / max(duration, 1));
+      uint32_t prevPhase = (curTime + Geometry::x) * phaseStep;
+      curTime++;
+      uint32_t curPhase = prevPhase + phaseStep;
+
+      for (int i = Geometry::x; i < bound; i++) {
+        screen.Display::drawPixel(i, waveY(prevPhase, prevAmplitude), Geometry::background);
+        screen.Display::drawPixel(i, waveY(curPhase, curAmplitude), Geometry::color);
+        prevPhase += phaseStep;
+        curPhase += phaseStep;
+      }
+
+      prevAmplitude = curAmplitude;
+
+      // Clear pixels between previous progress bar and current
+      int sign = prevBound < bound ? 1 : -1;
+      for (int i = prevBound; i != bound; i += sign) {
+        screen.Display::drawFastVLine(i, Geometry::y - 2 * Geometry::height, 4 * Geometry::height, Geometry::background);
+      }
+
+      screen.Display::drawFastHLine(bound, Geometry::y, Geometry::width + Geometry::x - bound, Geometry::color);
+      screen.Display::drawFastVLine(bound, Geometry::y - 2 * Geometry::height, 4 * Geometry::height, Geometry::color);
+      prevBound = bound;
+    }
+
+    void setPlayState(bool state) {
+      playing = state;
+    }
+
+    void setAmplitudePercent(int amp) {
+      amplitudePercent = amp;
+    }
+
+    void setTargetAmplitude(int amp) {
+      targetAmplitudePercent = amp;
+    }
+
+    // Estimated progress now, in ms
+    int position() {
+      return max(0, min((int) clock.position(millis()), duration));
+    }
+
+    // Progress observed at millis() == at, set the play state first. jump
+    // snaps straight to it, for new tracks.
+    void updateProgress(int val, uint32_t at, bool jump) {
+      clock.observe(val, playing, at, jump);
+      progress = max(0, min((int) clock.position(millis()), duration));
+    }
+};
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef PLAYBACKCLOCK_H
+#define PLAYBACKCLOCK_H
+#include <stdint.h>
+
+#define CLOCK_SNAP_MS       1500     // Errors bigger than this jump instead of converging
+#define CLOCK_CONVERGE_MS   2000     // Time taken to absorb a smaller error
+#define CLOCK_MAX_SLEW_PPM  100000   // Fastest the clock may run fast/slow while converging
+#define CLOCK_MAX_DRIFT_PPM 10000    // Bound on the learnt millis() vs spotify drift
+#define CLOCK_DRIFT_GAIN    8        // Drift estimate moves 1/gain of the way per observation
+
+// Estimates playback position between polls. Each observation is compared
+// with the current estimate; small errors are absorbed by briefly running the
+// clock fast or slow so the bar never jumps, and the persistent part of the
+// error is learnt as drift. Seeks, skips and play state changes snap.
+class PlaybackClock {
+  private:
+    uint32_t anchorTime = 0;   // millis() of anchorPos
+    int32_t  anchorPos  = 0;   // ms
+    int32_t  slewPpm    = 0;
+    uint32_t slewMs     = 0;   // How long after anchorTime slewPpm applies
+    int32_t  driftPpm   = 0;
+    uint32_t lastObserved = 0;
+    bool     playing    = false;
+    bool     started    = false;
+
+    void snap(int32_t pos, uint32_t at) {
+      anchorPos  = pos;
+      anchorTime = at;
+      slewPpm    = 0;
+      slewMs     = 0;
+    }
+
+    static int32_t clampPpm(int64_t ppm, int32_t bound) {
+      return ppm > bound ? bound : ppm < -bound ? -bound : (int32_t) ppm;
+    }
+
+  public:
+    // Estimated position in ms at millis() == now
+    int32_t position(uint32_t now) const {
+      if (!playing) return anchorPos;
+
+      int64_t elapsed = (int32_t) (now - anchorTime);
+      int64_t slewed  = elapsed < (int64_t) slewMs ? elapsed : slewMs;
+      return anchorPos + elapsed + (elapsed * driftPpm + slewed * slewPpm) / 1000000;
+    }
+
+    // Feeds an observed position, valid at millis() == at. jump marks a known
+    // discontinuity (new track, seek) so the estimate snaps to it.
+    void observe(int32_t pos, bool isPlaying, uint32_t at, bool jump) {
+      int32_t predicted = position(at);
+      int32_t error = pos - predicted;
+
+      if (!started || jump || isPlaying != playing || error > CLOCK_SNAP_MS || error < -CLOCK_SNAP_MS) {
+        started = true;
+        playing = isPlaying;
+        lastObserved = at;
+        snap(pos, at);
+        return;
+      }
+
+      // Whatever error is left after the last correction is treated as drift
+      uint32_t since = at - lastObserved;
+      if (playing && since > 0) {
+        int64_t ppm = (int64_t) error * 1000000 / (int32_t) since;
+        driftPpm = clampPpm(driftPpm + ppm / CLOCK_DRIFT_GAIN, CLOCK_MAX_DRIFT_PPM);
+      }
+      lastObserved = at;
+
+      // Keep the displayed position continuous and run off the error from here
+      anchorPos  = predicted;
+      anchorTime = at;
+      slewPpm    = clampPpm((int64_t) error * 1000000 / CLOCK_CONVERGE_MS, CLOCK_MAX_SLEW_PPM);
+      slewMs     = slewPpm == 0 ? 0 : (uint32_t) ((int64_t) error * 1000000 / slewPpm);
+      if (!playing) snap(pos, at);
+    }
+};
+
+#endif
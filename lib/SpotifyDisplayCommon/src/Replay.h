@@ -0,0 +1,229 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+#include <stdint.h>
+#include <stddef.h>
+
+// Compact binary log of everything the display reacts to: spotify responses,
+// album art downloads and knob samples, each stamped with its arrival time.
+// Captured on the device and played back through the same handlers, on the
+// device or the host, to reproduce field behaviour on a bench.
+//
+// Little endian throughout. The log starts with REPLAY_MAGIC and
+// REPLAY_VERSION, then records of
+//   kind u8, at u32 (ms since capture started)
+// followed by, per kind:
+//   REPLAY_AUTH/PLAYER/VOLUME  status i16, flags u8, rtt u16 (ms), length u32, body
+//   REPLAY_ART                 status i16 (200, or 0 if the download failed),
+//                              length u32, hash u32 (FNV-1a of the file)
+//   REPLAY_POT                 value u16 (raw analogRead), logged when it moves
+//                              past the knob wobble the display ignores
+
+#define REPLAY_MAGIC   0x4c524453   // "SDRL"
+#define REPLAY_VERSION 1
+
+// Body was gzip encoded, and is stored as it arrived
+#define REPLAY_GZIP      0x01
+// Body was longer than the capture keeps, only its start is stored
+#define REPLAY_TRUNCATED 0x02
+
+enum ReplayKind : uint8_t {
+  REPLAY_AUTH = 1,
+  REPLAY_PLAYER,
+  REPLAY_VOLUME,
+  REPLAY_ART,
+  REPLAY_POT
+};
+
+struct ReplayRecord {
+  uint8_t  kind;
+  uint32_t at;       // ms since capture started
+  int16_t  status;   // HTTP status, negative for client errors
+  uint8_t  flags;
+  uint16_t rtt;      // ms from request to response
+  uint32_t length;   // Body or art size in bytes
+  uint32_t hash;     // Art only
+  uint16_t value;    // Pot only
+};
+
+// FNV-1a, enough to tell whether two captures downloaded the same art
+inline uint32_t replayHash(uint32_t hash, const uint8_t* buf, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    hash ^= buf[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+#define REPLAY_HASH_INIT 2166136261u
+
+// Blanks a JSON string value in place, keeping its length so parse cost is
+// unchanged. Used to keep tokens out of captured auth responses.
+inline void replayRedact(uint8_t* body, size_t len, const char* key) {
+  size_t keyLen = 0;
+  while (key[keyLen]) keyLen++;
+
+  for (size_t i = 0; i + keyLen + 2 < len; i++) {
+    if (body[i] != '"') continue;
+
+    size_t j = 0;
+    while (j < keyLen && body[i + 1 + j] == (uint8_t) key[j]) j++;
+    if (j != keyLen || body[i + 1 + keyLen] != '"') continue;
+
+    // Skip to the opening quote of the value
+    size_t k = i + keyLen + 2;
+    while (k < len && body[k] != '"') k++;
+    for (k++; k < len && body[k] != '"'; k++) body[k] = 'x';
+    i = k;
+  }
+}
+
+// Out is anything with write(const uint8_t*, size_t), e.g. a LittleFS File or Serial
+template <typename Out>
+class ReplayWriter {
+  private:
+    Out& out;
+    uint32_t start = 0;
+
+    void put(uint32_t v, int bytes) {
+      uint8_t buf[4];
+      for (int i = 0; i < bytes; i++) buf[i] = v >> (8 * i);
+      out.write(buf, bytes);
+    }
+
+  public:
+    explicit ReplayWriter(Out& out) : out(out) {}
+
+    // Writes the log header, record times are relative to start
+    void begin(uint32_t start) {
+      this->start = start;
+      put(REPLAY_MAGIC, 4);
+      put(REPLAY_VERSION, 1);
+    }
+
+    void response(uint8_t kind, uint32_t now, int16_t status, uint8_t flags, uint16_t rtt, const uint8_t* body, uint32_t length) {
+      put(kind, 1);
+      put(now - start, 4);
+      put((uint16_t) status, 2);
+      put(flags, 1);
+      put(rtt, 2);
+      put(length, 4);
+      if (length != 0) out.write(body, length);
+    }
+
+    void art(uint32_t now, int16_t status, uint32_t length, uint32_t hash) {
+      put(REPLAY_ART, 1);
+      put(now - start, 4);
+      put((uint16_t) status, 2);
+      put(length, 4);
+      put(hash, 4);
+    }
+
+    void pot(uint32_t now, uint16_t value) {
+      put(REPLAY_POT, 1);
+      put(now - start, 4);
+      put(value, 2);
+    }
+};
+
+// In is anything with read(uint8_t*, size_t) returning the bytes read. Bodies
+// are streamed with body() after next(), any left unread are skipped.
+template <typename In>
+class ReplayReader {
+  private:
+    In& in;
+    uint32_t unread = 0;
+    bool failed = false;
+
+    bool get(uint32_t& v, int bytes) {
+      uint8_t buf[4];
+      if (failed || (size_t) in.read(buf, bytes) != (size_t) bytes) {
+        failed = true;
+        return false;
+      }
+
+      v = 0;
+      for (int i = 0; i < bytes; i++) v |= (uint32_t) buf[i] << (8 * i);
+      return true;
+    }
+
+  public:
+    explicit ReplayReader(In& in) : in(in) {}
+
+    // Checks the log header, false if it isn't a log this build understands
+    bool begin() {
+      uint32_t magic, version;
+      return get(magic, 4) && magic == REPLAY_MAGIC && get(version, 1) && version == REPLAY_VERSION;
+    }
+
+    // Reads the next record header, false at the end of the log
+    bool next(ReplayRecord& rec) {
+      uint8_t skip[64];
+      while (unread != 0) {
+        if (body(skip, sizeof(skip)) == 0) return false;
+      }
+
+      uint32_t kind, at, status = 0, flags = 0, rtt = 0, length = 0, hash = 0, value = 0;
+      if (!get(kind, 1) || !get(at, 4)) return false;
+
+      switch (kind) {
+        case REPLAY_AUTH:
+        case REPLAY_PLAYER:
+        case REPLAY_VOLUME:
+          if (!get(status, 2) || !get(flags, 1) || !get(rtt, 2) || !get(length, 4)) return false;
+          unread = length;
+          break;
+
+        case REPLAY_ART:
+          if (!get(status, 2) || !get(length, 4) || !get(hash, 4)) return false;
+          break;
+
+        case REPLAY_POT:
+          if (!get(value, 2)) return false;
+          break;
+
+        default:
+          failed = true;
+          return false;
+      }
+
+      rec.kind   = kind;
+      rec.at     = at;
+      rec.status = (int16_t) status;
+      rec.flags  = flags;
+      rec.rtt    = rtt;
+      rec.length = length;
+      rec.hash   = hash;
+      rec.value  = value;
+      return true;
+    }
+
+    // Reads up to len bytes of the current record's body, 0 once it is used up
+    size_t body(uint8_t* buf, size_t len) {
+      if (failed || unread == 0) return 0;
+      if (len > unread) len = unread;
+
+      size_t n = in.read(buf, len);
+      if (n == 0) failed = true;
+      unread -= n;
+      return n;
+    }
+};
+
+// Loop iteration times over a replay, to compare firmware versions
+struct FrameStats {
+  uint32_t frames = 0;
+  uint64_t total  = 0;   // us
+  uint32_t worst  = 0;   // us
+
+  void add(uint32_t us) {
+    frames++;
+    total += us;
+    if (us > worst) worst = us;
+  }
+
+  uint32_t mean() const {
+    return frames ? total / frames : 0;
+  }
+};
+
+#endif
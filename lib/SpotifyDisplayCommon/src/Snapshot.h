@@ -0,0 +1,47 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+#include <stdint.h>
+#include <atomic>
+
+// Lock-free single producer/single consumer snapshot of a T. The producer
+// fills writeBuffer() and publishes it with one atomic exchange; the consumer
+// picks up the latest published buffer with update() and reads it with no
+// locking. A third buffer sits between the two so neither side ever touches
+// the buffer the other is using, and the producer never waits on the reader.
+template <typename T>
+class Snapshot {
+  private:
+    static constexpr uint32_t FRESH = 0x4;
+    static constexpr uint32_t INDEX = 0x3;
+
+    T buffers[3];
+    uint32_t back  = 0;               // Producer only
+    uint32_t front = 1;               // Consumer only
+    std::atomic<uint32_t> middle{2};  // Handover, FRESH once published
+
+  public:
+    // Producer: buffer to fill before publish(). Holds stale data from an
+    // earlier publish, so every field must be written.
+    T& writeBuffer() {
+      return buffers[back];
+    }
+
+    // Producer: hands the write buffer over to the consumer
+    void publish() {
+      back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // Consumer: swaps in the latest published buffer, false if nothing new
+    bool update() {
+      if (!(middle.load(std::memory_order_acquire) & FRESH)) return false;
+      front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+      return true;
+    }
+
+    // Consumer: stable until the next update()
+    const T& read() const {
+      return buffers[front];
+    }
+};
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef SPOTIFYJSON_H
+#define SPOTIFYJSON_H
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "DisplayLayout.h"
+
+// Heap a parse may take on the ESP32, in bytes, counting everything ArduinoJson
+// allocates for the document and, for player responses, the filter. Documents
+// grow on the heap as they need to, so this is a budget rather than a size the
+// handlers declare; host/bench checks every payload in its corpus against it.
+#define PLAYER_HEAP_BUDGET 4096
+#define AUTH_HEAP_BUDGET   4096
+
+// Fields of a /v1/me/player response the display uses. Shared, along with the
+// readers below, so host builds parse exactly what the device does.
+inline void playerFilter(JsonDocument& filter) {
+  filter["progress_ms"]                          = true;
+  filter["is_playing"]                           = true;
+  filter["timestamp"]                            = true;
+  filter["device"]["volume_percent"]             = true;
+  filter["device"]["name"]                       = true;
+  filter["item"]["name"]                         = true;
+  filter["item"]["duration_ms"]                  = true;
+  filter["item"]["artists"][0]["name"]           = true;
+  filter["item"]["id"]                           = true;
+  filter["item"]["album"]["name"]                = true;
+  // The first element's filter applies to every image
+  filter["item"]["album"]["images"][0]["url"]    = true;
+  filter["item"]["album"]["images"][0]["width"]  = true;
+  filter["item"]["album"]["images"][0]["height"] = true;
+}
+
+// Fills next from a filtered player document, false if no track is playing.
+// Song is SongInfo, or the host's copy of it; text fields are read as whatever
+// string type it uses. rtt is the request's round trip in ms.
+template <typename Song>
+bool readPlayer(JsonDocument& doc, Song& next, uint32_t rtt) {
+  using Text = decltype(next.id);
+
+  JsonObject item = doc["item"];
+  if (item["id"].isNull()) return false;
+
+  JsonObject device = doc["device"];
+  JsonArray images  = item["album"]["images"];
+  next.id           = item["id"].as<Text>();
+  next.isPlaying    = doc["is_playing"].as<bool>();
+  next.timestamp    = doc["timestamp"].as<uint64_t>();
+  // Assume progress was sampled half way through the round trip
+  next.progressMs   = doc["progress_ms"].as<int>() + (next.isPlaying ? rtt / 2 : 0);
+  next.receivedAt   = millis();
+  next.volume       = device["volume_percent"].as<int>();
+  next.deviceName   = device["name"].as<Text>();
+  next.songName     = item["name"].as<Text>();
+  next.albumName    = item["album"]["name"].as<Text>();
+  next.artistName   = item["artists"][0]["name"].as<Text>();
+  next.durationMs   = item["duration_ms"].as<int>();
+  next.imgUrl       = Text();
+  next.height       = 0;
+  next.width        = 0;
+
+  for (size_t i = 0; i < images.size(); i++) {
+    int height = images[i]["height"].as<int>();
+    int width  = images[i]["width"].as<int>();
+
+    // Only grab appropriate sized image
+    if (height <= DisplayLayout::imgH * DisplayLayout::imgScale && width <= DisplayLayout::imgW * DisplayLayout::imgScale) {
+      next.height = height;
+      next.width  = width;
+      next.imgUrl = images[i]["url"].as<Text>();
+      break;
+    }
+  }
+
+  return true;
+}
+
+// Fills next from a token response. Refresh responses don't carry a refresh
+// token, which leaves next.refreshToken empty to keep the one already held.
+template <typename Auth>
+void readAuth(JsonDocument& doc, Auth& next) {
+  using Text = decltype(next.accessToken);
+
+  next.accessToken  = doc["access_token"].as<Text>();
+  next.expiry       = millis() + 1000 * doc["expires_in"].as<int>();
+  next.refreshToken = doc["refresh_token"].is<const char*>() ? doc["refresh_token"].as<Text>() : Text();
+}
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef TRACE_H
+#define TRACE_H
+#include <Arduino.h>
+#include <stdio.h>
+#if !defined(ESP8266)
+  #include <atomic>
+#endif
+
+// Ring buffer size in events, must be a power of two
+#ifndef TRACE_EVENTS
+  #define TRACE_EVENTS 512
+#endif
+
+#if defined(ESP32)
+  #define TRACE_CORE_ID() xPortGetCoreID()
+#else
+  #define TRACE_CORE_ID() 0
+#endif
+
+struct TraceEvent {
+  const char* name;   // Must outlive the trace, use string literals
+  uint32_t start;     // us
+  uint32_t dur;       // us
+  uint8_t  core;
+};
+
+// Always-on event tracer. Completed events are written into a fixed ring with
+// one atomic increment, so tracing from the loop and the AsyncTCP task costs a
+// couple of micros() calls and a 16 byte store. Old events are overwritten.
+class Trace {
+  private:
+    static inline TraceEvent events[TRACE_EVENTS];
+    #if defined(ESP8266)
+      // Single core and everything traced runs on the loop task
+      static inline uint32_t head = 0;
+      static uint32_t claim() { return head++; }
+    #else
+      static inline std::atomic<uint32_t> head{0};
+      static uint32_t claim() { return head.fetch_add(1, std::memory_order_relaxed); }
+    #endif
+
+  public:
+    // Toggled from loop() while the AsyncTCP task records
+    #if defined(ESP8266)
+      static inline bool enabled = true;
+    #else
+      static inline std::atomic<bool> enabled{true};
+    #endif
+
+    static void complete(const char* name, uint32_t start, uint32_t end) {
+      if (!enabled) return;
+      TraceEvent& e = events[claim() & (TRACE_EVENTS - 1)];
+      e.name  = name;
+      e.start = start;
+      e.dur   = end - start;
+      e.core  = TRACE_CORE_ID();
+    }
+
+    // Number of events held, oldest first from at(0)
+    static uint32_t count() {
+      uint32_t n = head;
+      return n < TRACE_EVENTS ? n : TRACE_EVENTS;
+    }
+
+    static const TraceEvent& at(uint32_t i) {
+      uint32_t n = head;
+      return events[(n - count() + i) & (TRACE_EVENTS - 1)];
+    }
+
+    // Formats event i as a chrome trace_event object, returns chars written
+    static int format(uint32_t i, char* buf, size_t len) {
+      const TraceEvent& e = at(i);
+      return snprintf(buf, len, "%s{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%lu,\"dur\":%lu,\"pid\":1,\"tid\":%u}",
+                      i == 0 ? "" : ",", e.name, (unsigned long) e.start, (unsigned long) e.dur, e.core);
+    }
+};
+
+// Records the enclosing scope as a complete event
+class TraceScope {
+  private:
+    const char* name;
+    uint32_t start;
+
+  public:
+    explicit TraceScope(const char* name) : name(name), start(micros()) {}
+    ~TraceScope() { Trace::complete(name, start, micros()); }
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b)  TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name)   TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+
+#endif
@@ -4,6 +4,9 @@
 #include <TJpg_Decoder.h>
 #include <ArduinoJson.h>
 #include <base64.h>
+#include <DisplayLayout.h>
+#include <PlaybackBar.h>
+#include <SpotifyJson.h>
 
 #if defined(ESP8266)
   #include <ESP8266WiFi.h> 
@@ -19,15 +22,18 @@
 #define TFT_CS        5          // D6
 #define TFT_RST       2          // D5
 #define TFT_DC        15         // D4
-#define TFT_WIDTH     240
-#define TFT_HEIGHT    320
 #define REQUEST_RATE  20000      // ms
+#define END_REQUEST_RATE 1000    // ms, minimum gap between end of song polls
+#define REQ_TIMEOUT   5000       // ms without data before giving up on a request
+#define LINE_MAX_SIZE 512        // bytes, status/header line
+#define BODY_BYTE_WAIT 20        // ms a streamed parse waits for each body byte before giving up
 #define IMG_PATH      "/img.jpg"
-#define PLAY_BAR_Y    300
-#define DRAW_RATE     50        // ms
+#define TEXT_INSET    10         // px, song text sits in from DisplayLayout::textX on this board
 
 // #define DEBUG         1
 
+using Screen = DFRobot_ST7789_240x320_HW_SPI;
+
 struct SongInfo {
   // General song info
   String songName;
@@ -43,6 +49,8 @@ struct SongInfo {
   // Playback info
   int durationMs;
   int progressMs;
+  uint32_t receivedAt;   // millis() progressMs was valid at
+  uint64_t timestamp;    // Spotify's last state change, unix ms
   int volume;
   String deviceName;
   bool isPlaying;
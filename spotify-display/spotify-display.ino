@@ -1,251 +1,329 @@
 #include "spotify-display.h"
 
-DFRobot_ST7789_240x320_HW_SPI screen(TFT_DC, TFT_CS, TFT_RST);
+Screen screen(TFT_DC, TFT_CS, TFT_RST);
 
-class PlaybackBar {
-  private:
-    bool playing = 1;
-    bool playStateFlag = 0;
-    uint16_t color;
-    int x, y;
-    int width, height;
-    float period;
-    int amplitude;
-    int prevBound = -1;
-    uint32_t curTime = 0;
-    int prevAmplitude;
-    uint32_t lastDraw = 0;
-
-  public:
-    int amplitudePercent;
-    int progress = 0;
-    int duration = 1;
-
-    PlaybackBar(int x, int y, int width, int height, int amplitude, float period, uint16_t color) {
-      this->x         = x;
-      this->y         = y;
-      this->width     = width;
-      this->height    = height;
-      this->color     = color;
-      this->amplitude = amplitude;
-      this->period    = period;
-    }
+// Requests SpotifyConn can have in flight, one at a time
+enum SpotifyRequest { SPOTIFY_NONE, SPOTIFY_AUTH, SPOTIFY_PLAYER, SPOTIFY_ART, SPOTIFY_VOLUME };
 
-    void draw() {
-      if (millis() - lastDraw < DRAW_RATE || (!playing && !playStateFlag)) {
-        return;
-      }
+// Where the response parser is up to
+enum ConnState { CONN_STATUS, CONN_HEADERS, CONN_BODY, CONN_CHUNK_SIZE, CONN_CHUNK_DATA, CONN_CHUNK_END, CONN_TRAILERS };
 
-      lastDraw = millis();
-      int curAmplitude = amplitude * (amplitudePercent / (float) 100);
-      int bound = x + width * (progress / (float) duration);
-      uint32_t prevTime = curTime;
-      curTime++;
+// Talks to spotify over a single BearSSL connection that is kept alive between
+// requests to the same host. Requests are started with request*() and the
+// response is read by poll() a little at a time as it arrives. JSON bodies are
+// streamed straight into a filtered parse once they start arriving, waiting at
+// most BODY_BYTE_WAIT for each byte, so the loop only waits on the network for
+// the TLS handshake on a new connection.
+class SpotifyConn {
+  private:
+    BearSSL::WiFiClientSecure client;
+    String connectedHost;
+    String accessToken;
+    String refreshToken;
 
-      // Stop playing
-      if (!playStateFlag && playing) {
+    // Request in flight, kept to resend if a reused connection turns out closed
+    SpotifyRequest request = SPOTIFY_NONE;
+    String pendingHost;
+    String pendingReq;
+    bool reused = false;
+
+    // Response in progress
+    ConnState state = CONN_STATUS;
+    String line;
+    File art;
+    int status = 0;
+    int remaining = -1;      // Body or chunk bytes left, -1 if delimited by the server closing
+    bool chunked = false;
+    bool keepAlive = true;
+    bool parsed = false;     // JSON body already handed to the parser
+    bool bodyDone = false;
+    bool truncated = false;
+    bool succeeded = false;
+    uint32_t sentAt = 0;
+    uint32_t lastProgress = 0;
+
+    // Hands the body to deserializeJson as it arrives, chunk framing removed.
+    // Stream's timed reads wait up to BODY_BYTE_WAIT for each byte, so a body
+    // that stalls fails the parse rather than holding up the loop.
+    class BodyStream : public Stream {
+      private:
+        SpotifyConn& conn;
+        int peeked = -1;
+
+      public:
+        BodyStream(SpotifyConn& conn) : conn(conn) {
+          setTimeout(BODY_BYTE_WAIT);
+        }
 
-        for (int i = prevAmplitude; i > 0; i--) {
-          for (int j = x; j < prevBound; j++) {
-            screen.drawPixel(j, y + i * sin(period * (prevTime + j)), COLOR_RGB565_BLACK);
-            screen.drawPixel(j, y + (i - 1) * sin(period * (prevTime + j)), color);
-          }
-          delay(100);
+        int available() override {
+          return peeked >= 0 ? 1 : conn.client.available();
         }
 
-        screen.drawFastVLine(prevBound, y-2*height, 4*height, COLOR_RGB565_BLACK);
-        screen.drawFastVLine(bound, y-2*height, 4*height, color);
-        playing = 0;
+        int read() override {
+          if (peeked >= 0) {
+            int c = peeked;
+            peeked = -1;
+            return c;
+          }
 
-      // Start playing after pause
-      } else if (playStateFlag && !playing) {
+          uint8_t c;
+          return conn.bodyRead(&c, 1) ? c : -1;
+        }
 
-        screen.drawFastVLine(prevBound, y-2*height, 4*height, COLOR_RGB565_BLACK);
-        screen.drawFastVLine(bound, y-2*height, 4*height, color);
+        int peek() override {
+          if (peeked < 0) peeked = read();
+          return peeked;
+        }
 
-        // Animate wave opening to full height when music starts playing again
-        for (int i = 1; i <= curAmplitude; i++) {
-          for (int j = x; j < bound; j++) {
-            screen.drawPixel(j, y + (i - 1) * sin(period * (curTime + j)), COLOR_RGB565_BLACK);
-            screen.drawPixel(j, y + i * sin(period * (curTime + j)), color);
-          }
-          delay(100);
+        size_t write(uint8_t b) override {
+          return 0;
         }
-        playing = 1;
-        prevBound = bound;
-        return;
+    };
 
-      } else {
-        // Draw wave
-        for (int i = x; i < bound; i++) {
-          screen.drawPixel(i, y + prevAmplitude * sin(period * (prevTime + i)), COLOR_RGB565_BLACK);
-          screen.drawPixel(i, y + curAmplitude * sin(period * (curTime + i)), color);
+    // Starts a request, reusing the open connection if it is to the same host
+    bool send(SpotifyRequest type, const String& host, const String& req) {
+      if (request != SPOTIFY_NONE) return false;
+
+      bool reuse = client.connected() && connectedHost == host;
+      if (!reuse) {
+        client.stop();
+        connectedHost = "";
+        if (!client.connect(host, 443)) {
+          #ifdef DEBUG
+            Serial.println(F("Connection failed!"));
+          #endif
+          return false;
         }
-        prevAmplitude = curAmplitude;
+        connectedHost = host;
       }
 
-      // Clear pixels between previous progress bar and current
-      int sign = prevBound < bound ? 1 : -1;
-      for (int i = prevBound; i != bound; i += sign) {
-        screen.drawFastVLine(i, y-2*height, 4*height, COLOR_RGB565_BLACK);
+      if (client.print(req) != req.length()) {
+        #ifdef DEBUG
+          Serial.println(F("Failed to send request..."));
+        #endif
+        client.stop();
+        connectedHost = "";
+        // The server may have closed an idle connection, try a fresh one
+        return reuse && send(type, host, req);
       }
-      screen.drawFastHLine(bound, y, width + x - bound, color);
-      screen.drawFastVLine(bound, y-2*height, 4*height, color);
-      prevBound = bound;
-    }
 
-    void setPlayState(bool state) {
-      playStateFlag = state;
+      request      = type;
+      pendingHost  = host;
+      pendingReq   = req;
+      reused       = reuse;
+      state        = CONN_STATUS;
+      status       = 0;
+      remaining    = -1;
+      chunked      = false;
+      keepAlive    = true;
+      parsed       = false;
+      bodyDone     = false;
+      truncated    = false;
+      succeeded    = false;
+      sentAt       = millis();
+      lastProgress = sentAt;
+      line         = "";
+      return true;
     }
-};
 
+    // Resends the request in flight on a fresh connection, once, for a reused
+    // connection that closed without answering
+    bool retry() {
+      if (!reused) return false;
 
-class SpotifyConn {
-  private:
-    BearSSL::WiFiClientSecure client;
-    String accessToken;
-    String refreshToken;
+      #ifdef DEBUG
+        Serial.println(F("Kept alive connection closed, reconnecting."));
+      #endif
+      String host = pendingHost;
+      String req  = pendingReq;
+      SpotifyRequest type = request;
+      client.stop();
+      connectedHost = "";
+      request = SPOTIFY_NONE;
+      if (send(type, host, req)) return true;
 
-  public:
-    SongInfo song;
-    bool accessTokenSet = false;
-    int expiry;
+      // Still in flight so poll() reports the failure
+      request = type;
+      return false;
+    }
 
-    SpotifyConn() {
-      client.setInsecure();
+    bool success() {
+      return status >= 200 && status < 300;
     }
 
-    // Connects to the network specified in credentials.h
-    void connect(const char* ssid, const char* passphrase) {
+    bool timedOut() {
+      if (millis() - lastProgress <= REQ_TIMEOUT) return false;
+
       #ifdef DEBUG
-        Serial.print(F("Attempting connection to "));
-        Serial.println(ssid);
+        Serial.println(F("Request timed out."));
       #endif
+      return true;
+    }
 
-      WiFi.begin(ssid, passphrase);
-      while ((WiFi.status() != WL_CONNECTED)) {
-        delay(200);
+    // Reads a status, header or chunk framing character, false on a malformed response
+    bool lineChar(char c) {
+      if (c == '\n') return handleLine();
+      if (c == '\r') return true;
+      if (line.length() >= LINE_MAX_SIZE) return false;
+      line += c;
+      return true;
+    }
+
+    // Handles a complete status, header or chunk line, false on a malformed response
+    bool handleLine() {
+      switch (state) {
+        case CONN_STATUS:
+          if (!line.startsWith(F("HTTP/1."))) return false;
+          status = line.substring(9, 12).toInt();
+          state  = CONN_HEADERS;
+          break;
+
+        case CONN_HEADERS: {
+          if (line.length() == 0) {
+            if (request == SPOTIFY_ART && success()) {
+              art = LittleFS.open(IMG_PATH, "w+");
+              if (!art) return false;
+            }
+
+            // No body on 204/304
+            if (status == 204 || status == 304) remaining = 0;
+            state = chunked ? CONN_CHUNK_SIZE : CONN_BODY;
+            break;
+          }
+
+          int colon = line.indexOf(':');
+          if (colon < 0) break;
+          String name  = line.substring(0, colon);
+          String value = line.substring(colon + 1);
+          name.toLowerCase();
+          value.trim();
+          value.toLowerCase();
+
+          if (name == F("content-length"))                                remaining = value.toInt();
+          else if (name == F("transfer-encoding") && value == F("chunked")) chunked = true;
+          else if (name == F("connection") && value == F("close"))          keepAlive = false;
+          break;
+        }
+
+        case CONN_CHUNK_SIZE:
+          remaining = strtol(line.c_str(), NULL, 16);
+          state = remaining == 0 ? CONN_TRAILERS : CONN_CHUNK_DATA;
+          break;
+
+        case CONN_CHUNK_END:
+          state = CONN_CHUNK_SIZE;
+          break;
+
+        case CONN_TRAILERS:
+          // Blank line after the last chunk's trailers ends the response
+          if (line.length() == 0) bodyDone = true;
+          break;
+
+        default:
+          break;
       }
 
-      #ifdef DEBUG
-        Serial.print(F("Successfully connected to "));
-        Serial.println(ssid);
-      #endif
+      line = "";
+      return true;
     }
 
-    bool getAuth(bool refresh, String code) {
-      const String host = F("accounts.spotify.com");
-      const String url  = F("/api/token");
-      const int port    = 443;
+    // Reads up to len bytes of body with any chunk framing removed, without
+    // waiting. Returns 0 if nothing more has arrived; bodyDone is set at the end.
+    size_t bodyRead(uint8_t* buf, size_t len) {
+      while (!bodyDone) {
+        if (state == CONN_BODY && remaining == 0) {
+          bodyDone = true;
+          break;
+        }
 
-      if (!client.connect(host, port)) {
-        #ifdef DEBUG
-          Serial.println(F("Connection failed!"));
-        #endif
-        return false;
+        int available = client.available();
+        if (available <= 0) {
+          if (!client.connected()) {
+            // Only a body without a length may end with the connection
+            keepAlive = false;
+            bodyDone  = true;
+            truncated = !(state == CONN_BODY && remaining < 0);
+          }
+          return 0;
+        }
+
+        lastProgress = millis();
+        if (state == CONN_BODY || state == CONN_CHUNK_DATA) {
+          size_t want = min((size_t) available, len);
+          if (remaining > 0) want = min(want, (size_t) remaining);
+
+          int bytes = client.read(buf, want);
+          if (bytes <= 0) return 0;
+          if (remaining > 0) {
+            remaining -= bytes;
+            if (remaining == 0 && state == CONN_CHUNK_DATA) state = CONN_CHUNK_END;
+          }
+          return bytes;
+        }
+
+        if (!lineChar(client.read())) {
+          bodyDone  = true;
+          truncated = true;
+        }
       }
 
-      String auth = F("Basic ") + base64::encode(String(CLIENT) + F(":") + String(CLIENT_SECRET));
-      String body;
+      return 0;
+    }
 
-      if (refresh) {
-        body = F("grant_type=refresh_token&refresh_token=") + refreshToken;
-      
-      } else {
-        body = F("grant_type=authorization_code&code=") + code + 
-               F("&redirect_uri=http://") + WiFi.localIP().toString() + F("/callback");
+    // Ends the request in flight, returning which one it was
+    SpotifyRequest finish(bool complete) {
+      SpotifyRequest done = request;
+      if (art) art.close();
+
+      // Parsed bodies report their parse, anything else needs a 2xx
+      succeeded = complete && (parsed ? succeeded : success());
+      if (!complete || !keepAlive) {
+        client.stop();
+        connectedHost = "";
       }
 
-      String req  = F("POST ") + url + F(" HTTP/1.0\r\nHost: ") + 
-                    host + F("\r\nContent-Length: ") + String(body.length()) +
-                    F("\r\nContent-Type: application/x-www-form-urlencoded\r\n") +
-                    F("Authorization: ") + auth + F("\r\nConnection: close\r\n\r\n") + 
-                    body;
+      #ifdef DEBUG
+        if (!succeeded) Serial.printf("Request %d failed: HTTP %d\n", done, status);
+      #endif
 
-      client.print(req);
-      client.readStringUntil('{');
+      request    = SPOTIFY_NONE;
+      pendingReq = "";
+      line       = "";
+      return done;
+    }
 
-      DynamicJsonDocument doc(1024);
-      String json = F("{") + client.readStringUntil('\r');
-      DeserializationError err = deserializeJson(doc, json);
+    bool parseAuth(Stream& body) {
+      JsonDocument doc;
+      DeserializationError err = deserializeJson(doc, body);
 
       if (err) {
         #ifdef DEBUG
-          Serial.print(F("Deserialisation failed for string: "));
-          Serial.println(json);
+          Serial.print(F("Auth deserialisation failed: "));
           Serial.println(err.f_str());
         #endif
         return false;
       }
 
-      // TODO check if these keys are present first
       accessToken = doc["access_token"].as<String>();
-      refreshToken = doc["refresh_token"].as<String>();
+      // Refresh token not included in refresh responses
+      if (doc["refresh_token"].is<const char*>()) refreshToken = doc["refresh_token"].as<String>();
       expiry = millis() + 1000 * doc["expires_in"].as<int>();
 
       accessTokenSet = true;
+      #ifdef DEBUG
+        Serial.println(F("Successfully got access tokens!"));
+      #endif
       return true;
     }
 
-    bool getCurrentlyPlaying() {
-      const String host = F("api.spotify.com");
-      const String url  = F("/v1/me/player");
-      const int port    = 443;
-
-      if (!client.connect(host, port)) {
-        #ifdef DEBUG
-          Serial.println(F("Connection failed!"));
-        #endif
-        return false;
-      }
+    bool parseCurrentlyPlaying(Stream& body) {
+      rtt = millis() - sentAt;
 
-      String auth = F("Bearer ") + accessToken;
-      String req  = F("GET ") + url + F(" HTTP/1.0\r\nHost: ") +
-                    host + F("\r\nAuthorization: ") +
-                    auth + F("\r\nCache-Control: no-cache\r\nConnection: close\r\n\r\n"); 
+      JsonDocument doc;
+      JsonDocument filter;
+      playerFilter(filter);
 
-      client.print(req);
-      String ln = client.readStringUntil('\r');
-      int start     = ln.indexOf(' ') + 1;
-      int end       = ln.indexOf(' ', start);
-      String status = ln.substring(start, end);
-
-      if (strcmp(status.c_str(), "200") != 0) {
-        #ifdef DEBUG
-          Serial.println(F("An error occurred: HTTP ") + status);
-        #endif
-        return false;
-      }
-
-      if (!client.find("\r\n\r\n")) {
-        #ifdef DEBUG
-          Serial.println(F("Invalid response from server."));
-        #endif
-        return false;
-      }
-
-      DynamicJsonDocument doc(1024);
-      StaticJsonDocument<300> filter;
-      filter["progress_ms"] = true;
-      filter["is_playing"]  = true;
-
-      JsonObject filter_device            = filter.createNestedObject("device");
-      JsonObject filter_item              = filter.createNestedObject("item");
-      JsonObject filter_item_album        = filter_item.createNestedObject("album");
-      JsonObject filter_item_album_images = filter_item_album["images"].createNestedObject();
-
-      filter_device["volume_percent"]    = true;
-      filter_device["name"]              = true;
-      filter_item["name"]                = true;
-      filter_item["duration_ms"]         = true;
-      filter_item["artists"][0]["name"]  = true;
-      filter_item["id"]                  = true;
-      filter_item_album["name"]          = true;
-      filter_item_album_images["url"]    = true;
-      filter_item_album_images["width"]  = true;
-      filter_item_album_images["height"] = true;
-
-      DeserializationError err = deserializeJson(doc, client, DeserializationOption::Filter(filter));
+      DeserializationError err = deserializeJson(doc, body, DeserializationOption::Filter(filter));
       if (err) {
         #ifdef DEBUG
           Serial.print(F("Deserialisation failed"));
@@ -254,163 +332,141 @@ class SpotifyConn {
         return false;
       }
 
-      JsonObject device = doc["device"];
-      JsonObject item   = doc["item"];
-      JsonArray images  = item["album"]["images"];
-      song.progressMs   = doc["progress_ms"].as<int>();
-      song.isPlaying    = doc["is_playing"].as<bool>();
-      song.volume       = device["volume_percent"].as<int>();
-      song.deviceName   = device["name"].as<String>();
-      song.id           = item["id"].as<String>();
-      song.songName     = item["name"].as<String>();
-      song.albumName    = item["album"]["name"].as<String>();
-      song.artistName   = item["artists"][0]["name"].as<String>();
-      song.durationMs   = item["duration_ms"].as<int>();
-
-      for (int i = 0; i < images.size(); i++) {
-        int height = images[i]["height"].as<int>();
-        int width  = images[i]["width"].as<int>();
-
-        if (height <= 300 && width <= 300) {
-          song.height = height;
-          song.width  = width;
-          song.imgUrl = images[i]["url"].as<String>();
-          break;
-        }
-      }
-
+      // No track (an ad or nothing loaded), keep the last one on screen stopped
+      if (!readPlayer(doc, song, rtt)) song.isPlaying = false;
       return true;
     }
 
-    bool getAlbumArt() {
-      const String host = F("i.scdn.co");
-      const String url  = song.imgUrl.substring(17);
-      const int port    = 443;
+  public:
+    SongInfo song;
+    bool accessTokenSet = false;
+    int expiry;
+    uint32_t rtt = 0;        // Time to the first byte of the last player response, ms
 
-      if (!client.connect(host, port)) {
-        #ifdef DEBUG
-          Serial.println(F("Connection failed!"));
-        #endif
-        return false;
-      }
+    SpotifyConn() {
+      client.setInsecure();
+    }
 
-      String req = F("GET ") + url + F(" HTTP/1.0\r\nHost: ") +
-                   host + F("\r\nCache-Control: no-cache\r\n");
+    // Connects to the network specified in credentials.h
+    void connect(const char* ssid, const char* passphrase) {
+      #ifdef DEBUG
+        Serial.print(F("Attempting connection to "));
+        Serial.println(ssid);
+      #endif
 
-      if (client.println(req) == 0) {
-        #ifdef DEBUG
-          Serial.println(F("Failed to send request..."));
-        #endif
-        return false;
+      WiFi.begin(ssid, passphrase);
+      while ((WiFi.status() != WL_CONNECTED)) {
+        delay(200);
       }
 
-      String ln     = client.readStringUntil('\r');
-      int start     = ln.indexOf(' ') + 1;
-      int end       = ln.indexOf(' ', start);
-      String status = ln.substring(start, end);
+      #ifdef DEBUG
+        Serial.print(F("Successfully connected to "));
+        Serial.println(ssid);
+      #endif
+    }
 
-      if (strcmp(status.c_str(), "200") != 0) {
-        #ifdef DEBUG
-          Serial.println(F("An error occurred: HTTP ") + status);
-        #endif
-        client.stop();
-        return false;
-      }
+    bool busy() {
+      return request != SPOTIFY_NONE;
+    }
 
-      if (!client.find("Content-Length:")) {
-        #ifdef DEBUG
-          Serial.println(F("Response had not content-length header."));
-        #endif
-        return false;
+    // Whether the request last returned by poll() succeeded
+    bool ok() {
+      return succeeded;
+    }
+
+    // Reads whatever part of the response has arrived. Returns the request that
+    // completed during this call, or SPOTIFY_NONE.
+    SpotifyRequest poll() {
+      if (request == SPOTIFY_NONE) return SPOTIFY_NONE;
+
+      // Status line and headers
+      while ((state == CONN_STATUS || state == CONN_HEADERS) && client.available() > 0) {
+        lastProgress = millis();
+        if (!lineChar(client.read())) return finish(false);
       }
 
-      int numBytes = client.parseInt();
-      if (!client.find("\r\n\r\n")) {
-        #ifdef DEBUG
-          Serial.println(F("Invalid response from server."));
-        #endif
-        client.stop();
-        return false;
+      if (state == CONN_STATUS || state == CONN_HEADERS) {
+        bool closed = !client.connected();
+        if (closed || timedOut()) {
+          // Nothing back at all on a reused connection, the server had likely closed it
+          if (state == CONN_STATUS && line.length() == 0 && retry()) return SPOTIFY_NONE;
+          return finish(false);
+        }
+        return SPOTIFY_NONE;
       }
 
-      File f = LittleFS.open(IMG_PATH, "w+");
-      if (!f) {
-        #ifdef DEBUG
-          Serial.println(F("Failed to write image to file..."));
-        #endif
-        return false;
+      // JSON bodies go into the parser once they start arriving. One that stalls
+      // mid parse fails it, the rest is drained below and the next poll retries.
+      if (!parsed && success() && (request == SPOTIFY_AUTH || request == SPOTIFY_PLAYER)) {
+        if (client.available() <= 0 && client.connected()) return timedOut() ? finish(false) : SPOTIFY_NONE;
+        parsed = true;
+        BodyStream body(*this);
+        succeeded = request == SPOTIFY_AUTH ? parseAuth(body) : status == 200 && parseCurrentlyPlaying(body);
       }
 
-      int offset = 0;
+      // Art goes to flash; anything after the JSON, or an error body, is dropped
       uint8_t buf[128];
-      while (offset < numBytes) {
+      for (size_t bytes; (bytes = bodyRead(buf, sizeof(buf))) > 0;) {
+        if (art && art.write(buf, bytes) != bytes) return finish(false);
+      }
 
-        size_t available = client.available();
+      if (bodyDone) return finish(!truncated);
+      return timedOut() ? finish(false) : SPOTIFY_NONE;
+    }
 
-        if (available) {
-          int bytes = client.readBytes(buf, min(available, sizeof(buf)));
-          f.write(buf, bytes);
-          offset += bytes;
-        }
+    bool requestAuth(bool refresh, String code) {
+      const String host = F("accounts.spotify.com");
+      String auth = F("Basic ") + base64::encode(String(CLIENT) + F(":") + String(CLIENT_SECRET));
+      String body;
 
-        // Reset WDT
-        yield();
+      if (refresh) {
+        body = F("grant_type=refresh_token&refresh_token=") + refreshToken;
+
+      } else {
+        body = F("grant_type=authorization_code&code=") + code +
+               F("&redirect_uri=http://") + WiFi.localIP().toString() + F("/callback");
       }
 
-      f.close();
-      #ifdef DEBUG
-        Serial.printf("Wrote to file %d/%d bytes\n", offset, numBytes);
-      #endif
-      client.stop();
-      return true;
+      String req = F("POST /api/token HTTP/1.1\r\nHost: ") + host +
+                   F("\r\nContent-Length: ") + String(body.length()) +
+                   F("\r\nContent-Type: application/x-www-form-urlencoded\r\n") +
+                   F("Authorization: ") + auth + F("\r\n\r\n") +
+                   body;
+
+      return send(SPOTIFY_AUTH, host, req);
     }
 
-    bool updateVolume() {
+    bool requestCurrentlyPlaying() {
       const String host = F("api.spotify.com");
-      const String url  = F("/v1/me/player/volume?volume_percent=") + String(song.volume);
-      const int port    = 443;
-
-      if (!client.connect(host, port)) {
-        #ifdef DEBUG
-          Serial.println(F("Connection failed!"));
-        #endif
-        return false;
-      }
+      String req = F("GET /v1/me/player HTTP/1.1\r\nHost: ") + host +
+                   F("\r\nAuthorization: Bearer ") + accessToken +
+                   F("\r\nCache-Control: no-cache\r\n\r\n");
 
-      String auth = F("Bearer ") + accessToken;
-      String req  = F("PUT ") + url +
-                    F(" HTTP/1.0\r\nHost: ") + host +
-                    F("\r\nAuthorization: ") + auth +
-                    F("\r\nContent-Length: 0") + 
-                    F("\r\nConnection: close\r\n\r\n");
+      return send(SPOTIFY_PLAYER, host, req);
+    }
 
-      if (client.println(req) == 0) {
-        #ifdef DEBUG
-          Serial.println(F("Failed to send request..."));
-        #endif
-        return false;
-      }
+    bool requestAlbumArt() {
+      const String host = F("i.scdn.co");
+      String req = F("GET ") + song.imgUrl.substring(17) + F(" HTTP/1.1\r\nHost: ") + host +
+                   F("\r\nCache-Control: no-cache\r\n\r\n");
 
-      String ln     = client.readStringUntil('\r');
-      int start     = ln.indexOf(' ') + 1;
-      int end       = ln.indexOf(' ', start);
-      String status = ln.substring(start, end);
+      return send(SPOTIFY_ART, host, req);
+    }
 
-      if (strcmp(status.c_str(), "204") != 0) {
-        #ifdef DEBUG
-          Serial.println(F("An error occurred: HTTP ") + status);
-        #endif
-        return false;
-      }
+    bool requestVolume() {
+      const String host = F("api.spotify.com");
+      String req = F("PUT /v1/me/player/volume?volume_percent=") + String(song.volume) +
+                   F(" HTTP/1.1\r\nHost: ") + host +
+                   F("\r\nAuthorization: Bearer ") + accessToken +
+                   F("\r\nContent-Length: 0\r\n\r\n");
 
-      return true;
+      return send(SPOTIFY_VOLUME, host, req);
     }
 };
 
-
 bool drawBmp(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t* bitmap) {
   // Stop drawing if out of bounds
-  if (y >= TFT_HEIGHT) {
+  if (y >= DisplayLayout::tftHeight) {
     return false;
   }
 
@@ -418,7 +474,7 @@ bool drawBmp(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t* bitmap) {
   return true;
 }
 
-PlaybackBar playbackBar = PlaybackBar(15, 310, TFT_WIDTH-30, 5, 8, 0.1, COLOR_RGB565_WHITE);
+PlaybackBar<Screen> playbackBar;
 SpotifyConn spotifyConn;
 
 #if defined(ESP8266)
@@ -439,12 +495,9 @@ void webServerHandleRoot() {
 
 void webServerHandleCallback() {
   if (server.arg("code") != "") {
-    if (spotifyConn.getAuth(false, server.arg("code"))) {
-      #ifdef DEBUG
-        Serial.println(F("Successfully got access tokens!"));
-      #endif
+    if (spotifyConn.requestAuth(false, server.arg("code"))) {
       server.send(200, "text/html", F("Login complete! you may close this tab.\r\n"));
-    
+
     } else {
       server.send(200, "text/html", F("Authentication failed... Please try again :(\r\n"));
     }
@@ -460,6 +513,56 @@ uint32_t lastRequest   = 0;
 uint32_t lastPotRead   = 0;
 uint32_t lastPotChange = 0;
 bool imageIsSet        = false;
+String shownId;
+uint64_t shownTimestamp = 0;
+uint32_t shownAt        = 0;
+
+// Updates the display after a successful player request
+void showSong() {
+  SongInfo& song = spotifyConn.song;
+  bool newSong = song.id != shownId;
+  // Spotify moves the timestamp on seeks, skips and play/pause
+  bool jump = newSong || song.timestamp != shownTimestamp;
+  shownTimestamp = song.timestamp;
+
+  #ifdef DEBUG
+    Serial.println(F("Polled API"));
+  #endif
+
+  if (newSong) {
+    shownId = song.id;
+
+    // Clear album art and song/artist text
+    screen.fillRect(0, 0, DisplayLayout::tftWidth, DisplayLayout::contentH, COLOR_RGB565_BLACK);
+
+    // Rewrite song/artist text
+    screen.setCursor(DisplayLayout::textX + TEXT_INSET, DisplayLayout::textY);
+    screen.setTextSize(2);
+    screen.setTextWrap(false);
+    screen.println(song.songName);
+    screen.setTextSize(1);
+    screen.println(song.artistName);
+
+    // Close playback bar wave when switching songs
+    playbackBar.setPlayState(false);
+    playbackBar.draw(screen, true);
+    imageIsSet = false;
+  }
+
+  playbackBar.setTargetAmplitude(song.volume);
+  playbackBar.duration = song.durationMs;
+  playbackBar.setPlayState(song.isPlaying);
+  // Polls with no track carry no progress, the bar just stops where it is
+  if (song.receivedAt != shownAt) {
+    shownAt = song.receivedAt;
+    playbackBar.updateProgress(song.progressMs, song.receivedAt, jump);
+  }
+  // Draw progress indicator to correct location before image loads
+  playbackBar.draw(screen, true);
+
+  // In the event of failure, continues fetching after each poll until success
+  if (!imageIsSet) spotifyConn.requestAlbumArt();
+}
 
 void setup() {
   #ifdef DEBUG
@@ -484,7 +587,7 @@ void setup() {
   server.begin();
 
   TJpgDec.setCallback(drawBmp);
-  TJpgDec.setJpgScale(2);
+  TJpgDec.setJpgScale(DisplayLayout::imgScale);
   spotifyConn.connect(SSID, PASSPHRASE);
 }
 
@@ -492,6 +595,23 @@ void loop(){
   server.handleClient();
   yield();
 
+  switch (spotifyConn.poll()) {
+    case SPOTIFY_PLAYER:
+      if (spotifyConn.ok()) showSong();
+      break;
+
+    case SPOTIFY_ART:
+      if (spotifyConn.ok()) {
+        SongInfo& song = spotifyConn.song;
+        TJpgDec.drawFsJpg((DisplayLayout::tftWidth - song.width / DisplayLayout::imgScale) / 2, DisplayLayout::imgY, IMG_PATH, LittleFS);
+        imageIsSet = true;
+      }
+      break;
+
+    default:
+      break;
+  }
+
   if (!spotifyConn.accessTokenSet) {
     screen.setCursor(0,0);
     screen.setTextSize(2);
@@ -500,66 +620,13 @@ void loop(){
   }
 
   if (millis() > spotifyConn.expiry) {
-    spotifyConn.getAuth(true, "");
+    spotifyConn.requestAuth(true, "");
   }
 
-  if (millis() - lastRequest > REQUEST_RATE || playbackBar.progress == playbackBar.duration) {
-    String prevId = spotifyConn.song.id;
+  // Poll at the end of a song to pick up the next one, but not in a tight loop
+  bool songEnded = playbackBar.progress == playbackBar.duration && millis() - lastRequest > END_REQUEST_RATE;
+  if ((millis() - lastRequest > REQUEST_RATE || songEnded) && spotifyConn.requestCurrentlyPlaying()) {
     lastRequest = millis();
-    if (spotifyConn.getCurrentlyPlaying()) {
-      
-      #ifdef DEBUG
-        Serial.println(F("Polled API"));
-      #endif
-
-      SongInfo song = spotifyConn.song;
-
-      // Base off song id instead
-      if (song.id != prevId) {
-
-        // Clear album art and song/artist text
-        screen.fillRect(0, 0, TFT_WIDTH, 300, COLOR_RGB565_BLACK);
-
-        // Rewrite song/artist text
-        screen.setCursor(10,240);
-        screen.setTextSize(2);
-        screen.setTextWrap(false);
-        screen.println(song.songName);
-        screen.setTextSize(1);
-        screen.println(song.artistName);
-
-        // Close playback bar wave when switching songs
-        playbackBar.setPlayState(false);
-        playbackBar.draw();
-        imageIsSet = false;
-      }
-
-      playbackBar.duration = song.durationMs;
-      playbackBar.progress = song.progressMs;
-      playbackBar.setPlayState(song.isPlaying);
-      // Draw progress indicator to correct location before image loads
-      playbackBar.draw();
-
-      // In the event of failure, continues fetching until success
-      if (!imageIsSet) {
-        // Get and draw album art
-        yield();
-        if (spotifyConn.getAlbumArt()) {
-          TJpgDec.drawFsJpg((TFT_WIDTH - song.width/2) / 2, 40, IMG_PATH, LittleFS);
-          imageIsSet = true;
-        }
-      }
-    
-    } else {
-      #ifdef DEBUG
-        Serial.println(F("Failed to fetch..."));
-      #endif
-    }
-
-  } else {
-    // Interpolate playback bar progress between api calls
-    int interpolatedTime = (int) (millis() - lastRequest + spotifyConn.song.progressMs);
-    playbackBar.progress = min(interpolatedTime, spotifyConn.song.durationMs);
   }
 
   // Read potentiometer value at fixed interval
@@ -570,23 +637,16 @@ void loop(){
     if (abs(spotifyConn.song.volume - newVol) > 2) {
       lastPotChange = millis();
       spotifyConn.song.volume = newVol;
+      playbackBar.setTargetAmplitude(newVol);
     }
 
     lastPotRead = millis();
   }
 
-  // Only send api POST when pot hasnt changed for a while
-  if (lastPotChange != 0 && millis() - lastPotChange > 3000) {
+  // Only send api PUT when pot hasnt changed for a while, retrying while the connection is busy
+  if (lastPotChange != 0 && millis() - lastPotChange > 3000 && spotifyConn.requestVolume()) {
     lastPotChange = 0;
-    spotifyConn.updateVolume();
-  }
-
-  // Slowly change amplitude of playback bar wave
-  if (playbackBar.amplitudePercent != spotifyConn.song.volume) {
-    int inc = playbackBar.amplitudePercent > spotifyConn.song.volume ? -6 : 6; 
-    playbackBar.amplitudePercent += inc;
-    playbackBar.amplitudePercent = min(max(0, playbackBar.amplitudePercent), 100);
   }
 
-  playbackBar.draw();
+  playbackBar.draw(screen, false);
 }